@@ -0,0 +1,383 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <sys/uio.h>
+
+#include "async_printer.h"
+
+namespace ll {
+
+static constexpr unsigned max_iov = 64;
+
+/* buffer */
+async_printer::buffer *async_printer::buffer::_new(size_t capacity) noexcept
+{
+    capacity = ring_helper::capacity(capacity);
+    void *p;
+    if (::posix_memalign(&p, ll_cacheline_size, sizeof(buffer) + capacity)) {
+        return nullptr;
+    }
+    buffer *b = (buffer*)p;
+    b->_entry._next = nullptr;
+    new (&b->_refs) std::atomic<int>(2);
+    b->_mask = capacity - 1;
+    b->_data = (char*)(b + 1);
+    new (&b->_head) std::atomic<size_t>(0);
+    new (&b->_tail) std::atomic<size_t>(0);
+    return b;
+}
+
+void async_printer::buffer::release() noexcept
+{
+    if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::free(this);
+    }
+}
+
+/* holder */
+async_printer::holder::~holder() noexcept
+{
+    for (unsigned i = 0; i < slots; i++) {
+        if (_slots[i]._buffer) {
+            _slots[i]._buffer->release();
+        }
+    }
+}
+
+constexpr unsigned async_printer::flush_interval;
+std::atomic<unsigned long> async_printer::_next_id(0);
+thread_local async_printer::holder async_printer::_holder;
+thread_local async_printer::line async_printer::_line;
+
+static void write_all(int fd, const char *data, size_t size) noexcept
+{
+    while (size) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                std::this_thread::yield();
+                continue;
+            }
+            return;
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+/* async_printer */
+async_printer::async_printer(int fd, size_t buffer_size, int policy) noexcept :
+    _id(0), _fd(fd), _policy(policy), _buffer_size(buffer_size),
+    _incoming(), _buffers(), _dropped(0),
+    _running(false), _stopping(false), _kick(false),
+    _drop_report(text_drop_report) {}
+
+async_printer::~async_printer() noexcept
+{
+    close();
+}
+
+int async_printer::open()
+{
+    if (_running.load(std::memory_order_relaxed)) {
+        return ok;
+    }
+
+    /* threads holding a buffer of an earlier open get a new one */
+    _id = ++_next_id;
+    _stopping.store(false, std::memory_order_relaxed);
+    _running.store(true, std::memory_order_release);
+
+    /* drops before the writer is scheduled are reported too */
+    unsigned long reported = _dropped.load(std::memory_order_relaxed);
+    _thread = std::thread([this, reported]() { run(reported); });
+    return ok;
+}
+
+/* a line racing with close may be lost */
+void async_printer::close()
+{
+    if (!_running.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    _stopping.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+    }
+    _cond.notify_one();
+    _thread.join();
+
+    while (buffer *b = _buffers.pop_front()) {
+        b->release();
+    }
+    buffer_list incoming = _incoming.take_all();
+    while (buffer *b = incoming.pop_front()) {
+        b->release();
+    }
+}
+
+async_printer::buffer *async_printer::get_buffer() noexcept
+{
+    holder &h = _holder;
+    holder::slot *s = nullptr;
+    for (unsigned i = 0; i < holder::slots; i++) {
+        holder::slot &slot = h._slots[i];
+        if (ll_likely(slot._id == _id)) {
+            return slot._buffer;
+        }
+        if (!s) {
+            /* the printer let go of it, closed or opened again */
+            if (slot._buffer && slot._buffer->_refs.load(std::memory_order_acquire) == 1) {
+                slot._buffer->release();
+                slot._buffer = nullptr;
+                slot._id = 0;
+            }
+            if (!slot._buffer) {
+                s = &slot;
+            }
+        }
+    }
+
+    /* all taken by live printers */
+    if (!s) {
+        s = &h._slots[h._victim++ % holder::slots];
+        s->_buffer->release();
+        s->_buffer = nullptr;
+        s->_id = 0;
+    }
+
+    buffer *b = buffer::_new(_buffer_size);
+    if (!b) {
+        return nullptr;
+    }
+    s->_id = _id;
+    s->_buffer = b;
+    _incoming.push(b);
+    return b;
+}
+
+/* a notify may slip in before the writer waits, it then waits one interval */
+void async_printer::kick() noexcept
+{
+    if (!_kick.exchange(true, std::memory_order_relaxed)) {
+        _cond.notify_one();
+    }
+}
+
+void async_printer::write_direct(const char *data, size_t size) noexcept
+{
+    std::lock_guard<std::mutex> lock(_fd_mutex);
+    write_all(_fd, data, size);
+}
+
+bool async_printer::write(const char *data, size_t size) noexcept
+{
+    if (!_running.load(std::memory_order_acquire)) {
+        write_direct(data, size);
+        return true;
+    }
+
+    buffer *b = get_buffer();
+    if (!b || size > b->_mask + 1) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t capacity = b->_mask + 1;
+    size_t tail = b->_tail.load(std::memory_order_relaxed);
+    size_t head;
+    for (;;) {
+        head = b->_head.load(std::memory_order_acquire);
+        if (capacity - (tail - head) >= size) {
+            break;
+        }
+        if (_policy == policy_drop || !_running.load(std::memory_order_relaxed)) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            kick();
+            return false;
+        }
+        kick();
+        std::this_thread::yield();
+    }
+
+    size_t offset = tail & b->_mask;
+    size_t n = capacity - offset;
+    if (n >= size) {
+        memcpy(b->_data + offset, data, size);
+    }
+    else {
+        memcpy(b->_data + offset, data, n);
+        memcpy(b->_data, data + n, size - n);
+    }
+    b->_tail.store(tail + size, std::memory_order_release);
+
+    /* the writer wakes by itself every interval, only a filling ring hurries it */
+    if ((tail + size - head) > (capacity >> 1)) {
+        kick();
+    }
+    return true;
+}
+
+/* one writev over every ring, repeated until they are empty or the batch is
+ * short. rings of ended threads go once they are drained. */
+size_t async_printer::drain() noexcept
+{
+    buffer_list incoming = _incoming.take_all();
+    while (buffer *b = incoming.pop_front()) {
+        _buffers.push_front(b);
+    }
+
+    size_t total = 0;
+    for (;;) {
+        struct iovec iov[max_iov];
+        buffer *owners[max_iov];
+        size_t sizes[max_iov];
+        unsigned niov = 0, nbuf = 0;
+        size_t bytes = 0;
+
+        buffer *prev = nullptr;
+        buffer *b = _buffers.first();
+        while (b && niov + 2 <= max_iov) {
+            buffer *next = buffer_list::next(b);
+
+            /* the thread's last line is published before it lets go */
+            bool orphan = b->_refs.load(std::memory_order_acquire) == 1;
+            size_t head = b->_head.load(std::memory_order_relaxed);
+            size_t tail = b->_tail.load(std::memory_order_acquire);
+            if (head == tail) {
+                if (orphan) {
+                    _buffers.remove(b, prev);
+                    b->release();
+                }
+                else {
+                    prev = b;
+                }
+                b = next;
+                continue;
+            }
+
+            size_t offset = head & b->_mask;
+            size_t size = tail - head;
+            size_t n = b->_mask + 1 - offset;
+            if (n >= size) {
+                iov[niov].iov_base = b->_data + offset;
+                iov[niov++].iov_len = size;
+            }
+            else {
+                iov[niov].iov_base = b->_data + offset;
+                iov[niov++].iov_len = n;
+                iov[niov].iov_base = b->_data;
+                iov[niov++].iov_len = size - n;
+            }
+            owners[nbuf] = b;
+            sizes[nbuf++] = size;
+            bytes += size;
+            prev = b;
+            b = next;
+        }
+
+        if (!nbuf) {
+            return total;
+        }
+
+        ssize_t written;
+        {
+            std::lock_guard<std::mutex> lock(_fd_mutex);
+            do {
+                written = ::writev(_fd, iov, niov);
+            } while (written < 0 && (errno == EINTR || errno == EAGAIN));
+        }
+
+        /* on a hard error the data is thrown away, the rings must not fill */
+        size_t done = written < 0 ? bytes : (size_t)written;
+        for (unsigned i = 0; i < nbuf && done; i++) {
+            size_t n = sizes[i] < done ? sizes[i] : done;
+            owners[i]->_head.store(owners[i]->_head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+            done -= n;
+        }
+        total += written < 0 ? bytes : written;
+
+        if (!b && written >= 0 && (size_t)written == bytes) {
+            return total;
+        }
+    }
+}
+
+size_t async_printer::text_drop_report(char *buf, size_t size, unsigned long n) noexcept
+{
+    size_t len = log_header(log_type_error, buf, size);
+    int m = snprintf(buf + len, size - len, "log: %lu lines dropped\n", n);
+    if (m < 0) {
+        return 0;
+    }
+    return (size_t)m < size - len ? len + m : size - 1;
+}
+
+void async_printer::report_dropped(unsigned long &reported) noexcept
+{
+    unsigned long dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped == reported) {
+        return;
+    }
+
+    char buf[128];
+    size_t n = _drop_report ? _drop_report(buf, sizeof(buf), dropped - reported) : 0;
+    if (n) {
+        write_direct(buf, n);
+    }
+    reported = dropped;
+}
+
+void async_printer::run(unsigned long reported) noexcept
+{
+    while (!_stopping.load(std::memory_order_acquire)) {
+        if (!drain()) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait_for(lock, std::chrono::milliseconds(flush_interval), [this]() {
+                return _kick.load(std::memory_order_relaxed) || _stopping.load(std::memory_order_relaxed);
+            });
+        }
+        _kick.store(false, std::memory_order_relaxed);
+        report_dropped(reported);
+    }
+    while (drain());
+    report_dropped(reported);
+}
+
+void *async_printer::prepare(int type)
+{
+    line &l = _line;
+    l._size = log_header(type, l._data, max_line);
+    return &l;
+}
+
+/* a line longer than max_line is cut and still ends the line */
+void async_printer::vprint(void *context, const char *fmt, va_list ap)
+{
+    line *l = (line*)context;
+    size_t room = max_line - l->_size;
+    int n = vsnprintf(l->_data + l->_size, room, fmt, ap);
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n < room) {
+        l->_size += n;
+    }
+    else {
+        l->_size = max_line - 1;
+        l->_data[l->_size - 1] = '\n';
+    }
+}
+
+void async_printer::flush(void *context)
+{
+    line *l = (line*)context;
+    write(l->_data, l->_size);
+}
+
+}
@@ -0,0 +1,145 @@
+#ifndef __LIBLLPP_ASYNC_PRINTER_H__
+#define __LIBLLPP_ASYNC_PRINTER_H__
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unistd.h>
+
+#include "etc.h"
+#include "list.h"
+#include "ring.h"
+#include "log.h"
+
+namespace ll {
+
+/* a log_printer that never writes on the caller's thread. every thread formats
+ * into its own line buffer and copies the line into its own byte ring, a writer
+ * thread gathers all rings into one writev. when a ring is full the line is
+ * dropped and counted, or the caller waits for the writer. */
+class async_printer : public log_printer {
+public:
+    enum {
+        policy_drop,
+        policy_block,
+    };
+
+    static constexpr size_t default_buffer_size     = 64 * 1024;
+    static constexpr size_t max_line                = 4096;
+    static constexpr unsigned flush_interval        = 10;       /* ms */
+
+    /* formats the note for n dropped records into buf, returns its size */
+    typedef size_t (*drop_report_fn)(char *buf, size_t size, unsigned long n);
+
+private:
+    /* single producer byte ring, the writer is the consumer. owned by its
+     * thread and by the printer, freed by whoever lets go last. */
+    struct buffer {
+        slist_entry _entry;
+        std::atomic<int> _refs;
+        size_t _mask;
+        char *_data;
+        alignas(ll_cacheline_size) std::atomic<size_t> _head;
+        alignas(ll_cacheline_size) std::atomic<size_t> _tail;
+
+        static buffer *_new(size_t capacity) noexcept;
+        void release() noexcept;
+    };
+
+    typedef mpsc_stack<buffer, slist_entry, &buffer::_entry> buffer_stack;
+    typedef list<buffer, slist_entry, &buffer::_entry> buffer_list;
+
+    /* the line being formatted, per thread */
+    struct line {
+        size_t _size;
+        char _data[max_line];
+    };
+
+    /* the buffers of the calling thread, one per printer it writes to, keyed
+     * by the id of the printer's open. released when the thread ends, or
+     * round robin when the thread writes to more live printers than there
+     * are slots, the writer frees a released buffer once it is drained. */
+    struct holder {
+        static constexpr unsigned slots = 8;
+
+        struct slot {
+            unsigned long _id;
+            buffer *_buffer;
+        };
+
+        slot _slots[slots];
+        unsigned _victim;
+
+        ~holder() noexcept;
+    };
+
+    static std::atomic<unsigned long> _next_id;
+    static thread_local holder _holder;
+    static thread_local line _line;
+
+    unsigned long _id;
+    int _fd;
+    int _policy;
+    size_t _buffer_size;
+    buffer_stack _incoming;
+    buffer_list _buffers;
+    std::atomic<unsigned long> _dropped;
+    std::atomic<bool> _running;
+    std::atomic<bool> _stopping;
+    std::atomic<bool> _kick;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::thread _thread;
+    std::mutex _fd_mutex;
+    drop_report_fn _drop_report;
+
+    static size_t text_drop_report(char *buf, size_t size, unsigned long n) noexcept;
+
+    buffer *get_buffer() noexcept;
+    void kick() noexcept;
+    void run(unsigned long reported) noexcept;
+    size_t drain() noexcept;
+    void report_dropped(unsigned long &reported) noexcept;
+
+public:
+    /* buffer_size is per thread, rounded up to a power of 2 */
+    async_printer(int fd = STDERR_FILENO, size_t buffer_size = default_buffer_size, int policy = policy_drop) noexcept;
+    async_printer(const async_printer&) = delete;
+    async_printer &operator=(const async_printer&) = delete;
+    ~async_printer() noexcept;
+
+    /* starts the writer thread */
+    int open();
+
+    /* writes what is buffered and stops the writer, later lines are written
+     * on the caller's thread */
+    void close();
+
+    /* one record, copied whole into the caller's ring and never split by the
+     * writer. false if it was dropped */
+    bool write(const char *data, size_t size) noexcept;
+
+    /* straight to the fd on the caller's thread, never dropped and never
+     * interleaved with the writer's output */
+    void write_direct(const char *data, size_t size) noexcept;
+
+    /* lines lost to full buffers so far */
+    unsigned long dropped() noexcept {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    /* how the writer notes drops in the output, a text line by default,
+     * nullptr notes nothing. set before open() */
+    void set_drop_report(drop_report_fn fn) noexcept {
+        _drop_report = fn;
+    }
+
+    void *prepare(int type);
+    void vprint(void *context, const char *fmt, va_list ap);
+    void flush(void *context);
+};
+
+}
+
+#endif
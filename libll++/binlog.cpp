@@ -0,0 +1,105 @@
+#include <mutex>
+#include <vector>
+
+#include "binlog.h"
+
+namespace ll {
+
+std::atomic<binlog*> binlog::_current(nullptr);
+
+/* every site used so far, the index is its id - 1 */
+static std::mutex __sites_mutex;
+static std::vector<binlog_site*> __sites;
+
+/* past the rings, site records are rare and must never be dropped */
+void binlog::write_site(binlog_site *site) noexcept
+{
+    size_t sig = strlen(site->_signature) + 1;
+    size_t file = strlen(site->_file) + 1;
+    size_t fmt = strlen(site->_fmt) + 1;
+    size_t size = sizeof(binlog_helper::site_record) + sig + file + fmt;
+
+    std::vector<char> buf(size);
+    binlog_helper::site_record *r = (binlog_helper::site_record*)buf.data();
+    r->_size = size;
+    r->_id = 0;
+    r->_site = site->_id.load(std::memory_order_relaxed);
+    r->_line = site->_line;
+    r->_type = site->_type;
+    char *p = (char*)(r + 1);
+    memcpy(p, site->_signature, sig);
+    memcpy(p + sig, site->_file, file);
+    memcpy(p + sig + file, site->_fmt, fmt);
+    _printer.write_direct(buf.data(), size);
+}
+
+/* the writer's note of drops, a record the decoder prints as a line */
+size_t binlog::drop_report(char *buf, size_t size, unsigned long n) noexcept
+{
+    if (size < sizeof(binlog_helper::drop_record)) {
+        return 0;
+    }
+    binlog_helper::drop_record r;
+    r._size = sizeof(r);
+    r._id = binlog_helper::drop_id;
+    r._usec = binlog_helper::now();
+    r._count = n;
+    memcpy(buf, &r, sizeof(r));
+    return sizeof(r);
+}
+
+unsigned binlog::register_site(binlog_site &site, const char *signature) noexcept
+{
+    std::lock_guard<std::mutex> lock(__sites_mutex);
+    unsigned id = site._id.load(std::memory_order_relaxed);
+    if (id) {
+        return id;
+    }
+    __sites.push_back(&site);
+    id = __sites.size();
+    site._signature = signature;
+    site._id.store(id, std::memory_order_release);
+
+    binlog *b = _current.load(std::memory_order_relaxed);
+    if (b) {
+        b->write_site(&site);
+    }
+    return id;
+}
+
+void binlog::fallback(const binlog_site *site, ...) noexcept
+{
+    va_list ap;
+    va_start(ap, site);
+    log(site->_type).vwrite(site->_fmt, ap);
+    va_end(ap);
+}
+
+int binlog::open()
+{
+    std::lock_guard<std::mutex> lock(__sites_mutex);
+    if (_current.load(std::memory_order_relaxed)) {
+        return e_busy;
+    }
+
+    /* before the writer runs, so the stream starts with it */
+    if (!_started) {
+        _printer.write_direct(binlog_helper::magic, sizeof(binlog_helper::magic));
+        _started = true;
+    }
+    ll_failed_return(_printer.open());
+    for (binlog_site *site : __sites) {
+        write_site(site);
+    }
+    _current.store(this, std::memory_order_release);
+    return ok;
+}
+
+void binlog::close()
+{
+    binlog *self = this;
+    _current.compare_exchange_strong(self, nullptr, std::memory_order_acq_rel);
+    _printer.close();
+}
+
+}
@@ -0,0 +1,260 @@
+#ifndef __LIBLLPP_BINLOG_H__
+#define __LIBLLPP_BINLOG_H__
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <time.h>
+
+#include "etc.h"
+#include "log.h"
+#include "async_printer.h"
+
+namespace ll {
+
+/* one ll_binlog call site, constant initialized so the call pays no guard.
+ * gets its id on first use. */
+struct binlog_site {
+    const char *_fmt;
+    const char *_file;
+    int _line;
+    int _type;
+    std::atomic<unsigned> _id;
+    const char *_signature;
+
+    constexpr binlog_site(int type, const char *fmt, const char *file, int line) noexcept :
+        _fmt(fmt), _file(file), _line(line), _type(type), _id(0), _signature(nullptr) {}
+};
+
+namespace binlog_helper { // begin namespace binlog_helper
+    /* the stream is in host byte order, read back on the same kind of host.
+     *   file:   magic, then records
+     *   record: u32 size (whole record), u32 id
+     *   id 0:   u32 site id, i32 line, i32 type, then signature, file and fmt, each
+     *           nul terminated
+     *   drop_id: i64 usec since the epoch, u64 records dropped since the last one
+     *   else:   i64 usec since the epoch, then the arguments, by signature:
+     *           i u 4 bytes, l L d p 8 bytes, s u32 length and the bytes */
+    static constexpr char magic[8] = { 'L', 'L', 'B', 'L', 'O', 'G', '1', '\0' };
+    static constexpr size_t max_record = 512;
+    static constexpr uint32_t drop_id = 0xffffffffU;
+
+    struct record {
+        uint32_t _size;
+        uint32_t _id;
+    };
+
+    struct site_record : record {
+        uint32_t _site;
+        int32_t _line;
+        int32_t _type;
+    };
+
+    struct entry_record : record {
+        int64_t _usec;
+    };
+
+    struct drop_record : entry_record {
+        uint64_t _count;
+    };
+
+    /* coarse clock, a few ns through the vdso and still finer than the ms a
+     * log line shows */
+    inline int64_t now() noexcept {
+        struct ::timespec ts;
+        ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    template <typename _T>
+    inline bool put(char *&p, char *end, _T v) noexcept {
+        if (ll_unlikely((size_t)(end - p) < sizeof(_T))) {
+            return false;
+        }
+        memcpy(p, &v, sizeof(_T));
+        p += sizeof(_T);
+        return true;
+    }
+
+    /* how an argument is kept, by its decayed type */
+    template <typename _T, typename = void>
+    struct arg;
+
+    template <typename _T>
+    struct arg<_T, typename std::enable_if<std::is_integral<_T>::value && sizeof(_T) <= 4>::type> {
+        static constexpr char code = std::is_signed<_T>::value ? 'i' : 'u';
+        static bool put(char *&p, char *end, _T v) noexcept {
+            return binlog_helper::put<uint32_t>(p, end, (uint32_t)v);
+        }
+    };
+
+    template <typename _T>
+    struct arg<_T, typename std::enable_if<std::is_integral<_T>::value && (sizeof(_T) > 4)>::type> {
+        static constexpr char code = std::is_signed<_T>::value ? 'l' : 'L';
+        static bool put(char *&p, char *end, _T v) noexcept {
+            return binlog_helper::put<uint64_t>(p, end, (uint64_t)v);
+        }
+    };
+
+    template <typename _T>
+    struct arg<_T, typename std::enable_if<std::is_enum<_T>::value>::type> :
+        arg<typename std::underlying_type<_T>::type> {
+        static bool put(char *&p, char *end, _T v) noexcept {
+            return arg<typename std::underlying_type<_T>::type>::put(
+                p, end, (typename std::underlying_type<_T>::type)v);
+        }
+    };
+
+    template <typename _T>
+    struct arg<_T, typename std::enable_if<std::is_floating_point<_T>::value>::type> {
+        static constexpr char code = 'd';
+        static bool put(char *&p, char *end, _T v) noexcept {
+            return binlog_helper::put<double>(p, end, (double)v);
+        }
+    };
+
+    /* the bytes are copied, the string may be gone when it is decoded */
+    template <typename _T>
+    struct arg<_T, typename std::enable_if<
+        std::is_same<_T, const char*>::value || std::is_same<_T, char*>::value>::type> {
+        static constexpr char code = 's';
+        static bool put(char *&p, char *end, const char *v) noexcept {
+            size_t len = v ? strlen(v) : 0;
+            if ((size_t)(end - p) < sizeof(uint32_t) + len) {
+                len = (size_t)(end - p) < sizeof(uint32_t) ? 0 : end - p - sizeof(uint32_t);
+            }
+            if (!binlog_helper::put<uint32_t>(p, end, (uint32_t)len)) {
+                return false;
+            }
+            if (len) {
+                memcpy(p, v, len);
+                p += len;
+            }
+            return true;
+        }
+    };
+
+    template <typename _T>
+    struct arg<_T, typename std::enable_if<std::is_pointer<_T>::value &&
+        !std::is_same<_T, const char*>::value && !std::is_same<_T, char*>::value>::type> {
+        static constexpr char code = 'p';
+        static bool put(char *&p, char *end, _T v) noexcept {
+            return binlog_helper::put<uint64_t>(p, end, (uint64_t)(uintptr_t)v);
+        }
+    };
+
+    template <typename ..._Args>
+    struct signature {
+        static constexpr char value[] = { arg<typename std::decay<_Args>::type>::code..., '\0' };
+    };
+
+    template <typename ..._Args>
+    constexpr char signature<_Args...>::value[];
+
+    inline void put_args(char *&, char *) noexcept {}
+
+    /* stops at the first argument that does not fit, the decoder marks the rest */
+    template <typename _T, typename ..._Rest>
+    inline void put_args(char *&p, char *end, const _T &v, const _Rest&...rest) noexcept {
+        if (arg<typename std::decay<_T>::type>::put(p, end, v)) {
+            put_args(p, end, rest...);
+        }
+    }
+
+    /* never called, lets the compiler check the arguments against fmt */
+    inline void check(const char *, ...) __attribute__((format(printf, 1, 2)));
+    inline void check(const char *, ...) {}
+} // end namespace binlog_helper
+
+/* deferred formatting. a call site records its format id, a timestamp and the
+ * raw arguments into the caller's ring of an async_printer, the text is made
+ * later by the ll_binlog decoder. format ids and their strings go into the
+ * stream once per open. with no binlog open the calls print through log. */
+class binlog {
+private:
+    async_printer _printer;
+    bool _started;
+
+    static std::atomic<binlog*> _current;
+
+    static unsigned register_site(binlog_site &site, const char *signature) noexcept;
+    static void fallback(const binlog_site *site, ...) noexcept;
+    static size_t drop_report(char *buf, size_t size, unsigned long n) noexcept;
+    void write_site(binlog_site *site) noexcept;
+
+public:
+    /* buffer_size is per thread */
+    binlog(int fd, size_t buffer_size = async_printer::default_buffer_size,
+           int policy = async_printer::policy_drop) noexcept :
+        _printer(fd, buffer_size, policy), _started(false) {
+        _printer.set_drop_report(drop_report);
+    }
+    binlog(const binlog&) = delete;
+    binlog &operator=(const binlog&) = delete;
+
+    ~binlog() noexcept {
+        close();
+    }
+
+    /* writes the header and the sites known so far, then takes the calls. the
+     * binlog must outlive every thread that may still call. a reopen goes on
+     * with the same stream, the header is written once */
+    int open();
+    void close();
+
+    unsigned long dropped() noexcept {
+        return _printer.dropped();
+    }
+
+    static binlog *current() noexcept {
+        return _current.load(std::memory_order_acquire);
+    }
+
+    template <typename ..._Args>
+    static void write(binlog_site &site, const _Args&...args) noexcept {
+        binlog *b = current();
+        if (ll_unlikely(!b)) {
+            fallback(&site, args...);
+            return;
+        }
+        if (ll_unlikely(!site._id.load(std::memory_order_acquire))) {
+            register_site(site, binlog_helper::signature<_Args...>::value);
+        }
+
+        alignas(8) char buf[binlog_helper::max_record];
+        binlog_helper::entry_record *r = (binlog_helper::entry_record*)buf;
+        char *p = (char*)(r + 1);
+        binlog_helper::put_args(p, buf + sizeof(buf), args...);
+        r->_size = p - buf;
+        r->_id = site._id.load(std::memory_order_relaxed);
+        r->_usec = binlog_helper::now();
+        b->_printer.write(buf, r->_size);
+    }
+};
+
+/* the text of a binlog stream, as log would have printed it, lines of all
+ * threads ordered by time. what cannot be decoded is described in errors,
+ * e_inval if data is not a binlog stream */
+int binlog_decode(const char *data, size_t size, std::string &out, std::string *errors = nullptr);
+
+/* filtered like ll_log, the arguments are not evaluated below the level */
+#define ll_binlog(type, fmt, ...)                                               \
+    do {                                                                        \
+        if ((type) >= LL_LOG_LEVEL && ll::log::enabled(type)) {                 \
+            static ll::binlog_site __ll_binlog_site(type, fmt, __FILE__, __LINE__); \
+            if (false) {                                                        \
+                ll::binlog_helper::check(fmt, ##__VA_ARGS__);                   \
+            }                                                                   \
+            ll::binlog::write(__ll_binlog_site, ##__VA_ARGS__);                 \
+        }                                                                       \
+    } while (0)
+
+#define ll_binlog_debug(fmt, ...)   ll_binlog(ll::log_type_debug, fmt, ##__VA_ARGS__)
+#define ll_binlog_info(fmt, ...)    ll_binlog(ll::log_type_info, fmt, ##__VA_ARGS__)
+#define ll_binlog_error(fmt, ...)   ll_binlog(ll::log_type_error, fmt, ##__VA_ARGS__)
+
+}
+
+#endif
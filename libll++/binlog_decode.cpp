@@ -0,0 +1,370 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "binlog.h"
+
+namespace ll {
+
+namespace {
+
+struct site {
+    std::string _signature;
+    std::string _file;
+    std::string _fmt;
+    int _line;
+    int _type;
+};
+
+struct entry {
+    int64_t _usec;
+    size_t _offset;
+};
+
+/* the arguments of one entry, read in signature order */
+class args {
+private:
+    const site &_site;
+    const char *_p;
+    const char *_end;
+    size_t _index;
+public:
+    args(const site &s, const char *p, const char *end) : _site(s), _p(p), _end(end), _index(0) {}
+
+    /* the next code, 0 if there is none left or its bytes were cut */
+    char next() {
+        if (_index >= _site._signature.size()) {
+            return 0;
+        }
+        char code = _site._signature[_index];
+        size_t size = code == 'i' || code == 'u' ? 4 : code == 's' ? 4 : 8;
+        return (size_t)(_end - _p) < size ? 0 : code;
+    }
+
+    bool get(int64_t &value) {
+        char code = next();
+        uint32_t u32;
+        uint64_t u64;
+        switch (code) {
+        case 'i':
+        case 'u':
+            memcpy(&u32, _p, 4);
+            _p += 4;
+            value = code == 'i' ? (int64_t)(int32_t)u32 : (int64_t)u32;
+            break;
+        case 'l':
+        case 'L':
+        case 'p':
+            memcpy(&u64, _p, 8);
+            _p += 8;
+            value = (int64_t)u64;
+            break;
+        case 'd': {
+            double d;
+            memcpy(&d, _p, 8);
+            _p += 8;
+            value = (int64_t)d;
+            break;
+        }
+        case 's':
+            skip_string();
+            value = 0;
+            break;
+        default:
+            return false;
+        }
+        _index++;
+        return true;
+    }
+
+    /* unsigned conversions of a 32 bit argument see 32 bits, as printf would */
+    bool get_unsigned(uint64_t &value) {
+        char code = next();
+        int64_t v;
+        if (!get(v)) {
+            return false;
+        }
+        value = code == 'i' || code == 'u' ? (uint64_t)(uint32_t)v : (uint64_t)v;
+        return true;
+    }
+
+    bool get(double &value) {
+        char code = next();
+        if (code != 'd') {
+            int64_t v;
+            if (!get(v)) {
+                return false;
+            }
+            value = (double)v;
+            return true;
+        }
+        memcpy(&value, _p, 8);
+        _p += 8;
+        _index++;
+        return true;
+    }
+
+    bool get(std::string &value) {
+        char code = next();
+        if (code != 's') {
+            int64_t v;
+            if (!get(v)) {
+                return false;
+            }
+            value = "(?)";
+            return true;
+        }
+        uint32_t len;
+        memcpy(&len, _p, 4);
+        _p += 4;
+        if (len > (size_t)(_end - _p)) {
+            len = _end - _p;
+        }
+        value.assign(_p, len);
+        _p += len;
+        _index++;
+        return true;
+    }
+
+private:
+    void skip_string() {
+        uint32_t len;
+        memcpy(&len, _p, 4);
+        _p += 4;
+        _p += std::min<size_t>(len, _end - _p);
+    }
+};
+
+template <typename _T>
+void append(std::string &out, const std::string &spec, _T value)
+{
+    char buf[256];
+    int n = snprintf(buf, sizeof(buf), spec.c_str(), value);
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n < sizeof(buf)) {
+        out.append(buf, n);
+        return;
+    }
+    std::vector<char> big(n + 1);
+    snprintf(big.data(), big.size(), spec.c_str(), value);
+    out.append(big.data(), n);
+}
+
+/* one conversion at a time, each with the type its conversion asks for, the
+ * length modifiers of fmt are dropped since the stored width is known */
+void format(std::string &out, const site &s, args &a)
+{
+    const char *p = s._fmt.c_str();
+    while (*p) {
+        if (*p != '%') {
+            out += *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out += '%';
+            p += 2;
+            continue;
+        }
+
+        std::string spec("%");
+        p++;
+        while (*p && strchr("-+ #0'", *p)) {
+            spec += *p++;
+        }
+        for (int part = 0; part < 2; part++) {
+            if (part) {
+                if (*p != '.') {
+                    break;
+                }
+                spec += *p++;
+            }
+            if (*p == '*') {
+                int64_t v = 0;
+                a.get(v);
+                spec += std::to_string(v);
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') {
+                spec += *p++;
+            }
+        }
+        while (*p && strchr("hlLqjzt", *p)) {
+            p++;
+        }
+
+        char conv = *p;
+        if (!conv) {
+            break;
+        }
+        p++;
+
+        bool got;
+        switch (conv) {
+        case 'd':
+        case 'i': {
+            int64_t v;
+            if ((got = a.get(v))) {
+                append(out, spec + "ll" + conv, (long long)v);
+            }
+            break;
+        }
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X': {
+            uint64_t v;
+            if ((got = a.get_unsigned(v))) {
+                append(out, spec + "ll" + conv, (unsigned long long)v);
+            }
+            break;
+        }
+        case 'c': {
+            int64_t v;
+            if ((got = a.get(v))) {
+                append(out, spec + conv, (int)v);
+            }
+            break;
+        }
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            double v;
+            if ((got = a.get(v))) {
+                append(out, spec + conv, v);
+            }
+            break;
+        }
+        case 's': {
+            std::string v;
+            if ((got = a.get(v))) {
+                append(out, spec + conv, v.c_str());
+            }
+            break;
+        }
+        case 'p': {
+            int64_t v;
+            if ((got = a.get(v))) {
+                append(out, spec + conv, (void*)(uintptr_t)v);
+            }
+            break;
+        }
+        default:
+            got = true;
+            break;
+        }
+        if (!got) {
+            out += "<?>";
+        }
+    }
+}
+
+}
+
+int binlog_decode(const char *data, size_t size, std::string &out, std::string *errors)
+{
+    const size_t header = sizeof(binlog_helper::magic);
+    if (size < header || memcmp(data, binlog_helper::magic, header)) {
+        return e_inval;
+    }
+
+    char msg[64];
+    auto error = [&](int n) {
+        if (errors && n > 0) {
+            errors->append(msg, std::min<size_t>(n, sizeof(msg) - 1));
+        }
+    };
+
+    /* sites may follow the first entries that use them, collect them all first */
+    std::vector<site> sites;
+    std::vector<entry> entries;
+    size_t pos = header;
+    while (pos + sizeof(binlog_helper::record) <= size) {
+        binlog_helper::record r;
+        memcpy(&r, data + pos, sizeof(r));
+        if (r._size < sizeof(r) || pos + r._size > size) {
+            error(snprintf(msg, sizeof(msg), "truncated at %zu\n", pos));
+            break;
+        }
+
+        if (!r._id) {
+            /* sites are numbered from 1 and each has a record of its own, a 
+               number past what the file could hold is as corrupt as a short record */
+            binlog_helper::site_record sr;
+            if (r._size < sizeof(sr)) {
+                error(snprintf(msg, sizeof(msg), "corrupt site record at %zu\n", pos));
+                pos += r._size;
+                continue;
+            }
+            memcpy(&sr, data + pos, sizeof(sr));
+            if (!sr._site || sr._site > size / sizeof(sr)) {
+                error(snprintf(msg, sizeof(msg), "corrupt site %u at %zu\n", sr._site, pos));
+                pos += r._size;
+                continue;
+            }
+
+            const char *p = data + pos + sizeof(sr);
+            const char *end = data + pos + r._size;
+            site s;
+            s._line = sr._line;
+            s._type = sr._type;
+            std::string *fields[] = { &s._signature, &s._file, &s._fmt };
+            for (std::string *f : fields) {
+                size_t len = strnlen(p, end - p);
+                f->assign(p, len);
+                p += std::min<size_t>(len + 1, end - p);
+            }
+            if (sites.size() < sr._site) {
+                sites.resize(sr._site);
+            }
+            sites[sr._site - 1] = s;
+        }
+        else if (r._size >= sizeof(binlog_helper::entry_record)) {
+            binlog_helper::entry_record er;
+            memcpy(&er, data + pos, sizeof(er));
+            entries.push_back(entry { er._usec, pos });
+        }
+        pos += r._size;
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](const entry &a, const entry &b) {
+        return a._usec < b._usec;
+    });
+
+    std::string line;
+    char buf[64];
+    for (const entry &e : entries) {
+        binlog_helper::record r;
+        memcpy(&r, data + e._offset, sizeof(r));
+        if (r._id == binlog_helper::drop_id) {
+            binlog_helper::drop_record dr = {};
+            memcpy(&dr, data + e._offset, std::min<size_t>(sizeof(dr), r._size));
+            out.append(buf, log_header(log_type_error, e._usec, buf, sizeof(buf)));
+            out += "binlog: " + std::to_string(dr._count) + " records dropped\n";
+            continue;
+        }
+        if (r._id > sites.size() || sites[r._id - 1]._fmt.empty()) {
+            error(snprintf(msg, sizeof(msg), "unknown site %u\n", r._id));
+            continue;
+        }
+        const site &s = sites[r._id - 1];
+
+        line.assign(buf, log_header(s._type, e._usec, buf, sizeof(buf)));
+        const char *p = data + e._offset + sizeof(binlog_helper::entry_record);
+        args a(s, p, data + e._offset + r._size);
+        format(line, s, a);
+        out += line;
+    }
+    return ok;
+}
+
+}
@@ -0,0 +1,622 @@
+#ifndef __LIBLLPP_BTREE_H__
+#define __LIBLLPP_BTREE_H__
+
+#include <cstddef>
+#include <utility>
+#include <new>
+
+#include "etc.h"
+#include "compare.h"
+#include "construct.h"
+#include "malloc_allocator.h"
+
+namespace ll {
+
+/* ordered map on a b+tree, keyed like map through _GetKey::get_key(value_type*).
+ * leaves are sorted arrays of keys and value pointers linked in order, inner
+ * nodes hold separator keys only, so a lookup touches a few cache lines per
+ * level instead of one node per comparison.
+ * as with map the values are not owned: remove() hands them back.
+ * keys are unique, and any insert or remove invalidates iterators. */
+template <
+    typename _Key,
+    typename _T,
+    typename _Allocator = malloc_allocator,
+    typename _Compare = comparer<_Key>,
+    typename _GetKey = _T,
+    unsigned __node_size = 512>
+class btree {
+public:
+    typedef _Key                                    key_type;
+    typedef _T                                      value_type;
+    typedef _Allocator                              allocator_type;
+    typedef _GetKey                                 getkey_type;
+    typedef _Compare                                compare_type;
+
+private:
+    struct node {
+        unsigned _count;
+        bool _leaf;
+    };
+
+    /* one spare slot each, a node overflows first and splits after */
+    static constexpr unsigned leaf_slots =
+        (__node_size - sizeof(node) - 2 * sizeof(void*)) / (sizeof(key_type) + sizeof(value_type*)) - 1;
+    static constexpr unsigned inner_slots =
+        (__node_size - sizeof(node) - 2 * sizeof(void*)) / (sizeof(key_type) + sizeof(node*)) - 1;
+    static constexpr unsigned leaf_min = leaf_slots / 2;
+    static constexpr unsigned inner_min = inner_slots / 2;
+    static constexpr unsigned max_depth = 32;
+
+    static_assert(leaf_slots >= 4 && inner_slots >= 4, "btree node size too small for the key");
+
+    struct leaf : node {
+        leaf *_prev;
+        leaf *_next;
+        key_type _keys[leaf_slots + 1];
+        value_type *_values[leaf_slots + 1];
+    };
+
+    struct inner : node {
+        key_type _keys[inner_slots + 1];
+        node *_children[inner_slots + 2];
+    };
+
+    /* the inner nodes passed on the way down, and the child taken in each */
+    struct path {
+        inner *_nodes[max_depth];
+        unsigned _pos[max_depth];
+    };
+
+    allocator_type *_allocator;
+    node *_root;
+    leaf *_first;
+    leaf *_last;
+    size_t _count;
+    unsigned _height;           /* inner levels above the leaves */
+
+    leaf *new_leaf() {
+        leaf *l = new (_allocator->alloc(sizeof(leaf))) leaf();
+        l->_count = 0;
+        l->_leaf = true;
+        l->_prev = l->_next = nullptr;
+        return l;
+    }
+
+    inner *new_inner() {
+        inner *n = new (_allocator->alloc(sizeof(inner))) inner();
+        n->_count = 0;
+        n->_leaf = false;
+        return n;
+    }
+
+    void free_node(node *n) {
+        if (n->_leaf) {
+            static_cast<leaf*>(n)->~leaf();
+            _allocator->free(n, sizeof(leaf));
+        }
+        else {
+            static_cast<inner*>(n)->~inner();
+            _allocator->free(n, sizeof(inner));
+        }
+    }
+
+    void free_tree(node *n) {
+        if (!n->_leaf) {
+            inner *in = static_cast<inner*>(n);
+            for (unsigned i = 0; i <= in->_count; i++) {
+                free_tree(in->_children[i]);
+            }
+        }
+        free_node(n);
+    }
+
+    /* first i with keys[i] >= key, branch free halving */
+    static unsigned lower(const key_type *keys, unsigned n, const key_type &key) {
+        const key_type *base = keys;
+        if (!n) {
+            return 0;
+        }
+        while (n > 1) {
+            unsigned half = n >> 1;
+            base = compare_type::compare(base[half], key) < 0 ? base + half : base;
+            n -= half;
+        }
+        return (base - keys) + (compare_type::compare(*base, key) < 0);
+    }
+
+    /* first i with keys[i] > key */
+    static unsigned upper(const key_type *keys, unsigned n, const key_type &key) {
+        const key_type *base = keys;
+        if (!n) {
+            return 0;
+        }
+        while (n > 1) {
+            unsigned half = n >> 1;
+            base = compare_type::compare(base[half], key) <= 0 ? base + half : base;
+            n -= half;
+        }
+        return (base - keys) + (compare_type::compare(*base, key) <= 0);
+    }
+
+    leaf *find_leaf(const key_type &key, path *p) const {
+        node *n = _root;
+        for (unsigned d = 0; d < _height; d++) {
+            inner *in = static_cast<inner*>(n);
+            unsigned i = upper(in->_keys, in->_count, key);
+            if (p) {
+                p->_nodes[d] = in;
+                p->_pos[d] = i;
+            }
+            n = in->_children[i];
+        }
+        return static_cast<leaf*>(n);
+    }
+
+    /* right follows left at depth d, sep is the first key under right */
+    void insert_parent(path &p, unsigned d, node *left, key_type &sep, node *right) {
+        if (!d) {
+            inner *root = new_inner();
+            root->_count = 1;
+            root->_keys[0] = std::move(sep);
+            root->_children[0] = left;
+            root->_children[1] = right;
+            _root = root;
+            _height++;
+            return;
+        }
+
+        inner *in = p._nodes[d - 1];
+        unsigned pos = p._pos[d - 1];
+        for (unsigned i = in->_count; i > pos; i--) {
+            in->_keys[i] = std::move(in->_keys[i - 1]);
+            in->_children[i + 1] = in->_children[i];
+        }
+        in->_keys[pos] = std::move(sep);
+        in->_children[pos + 1] = right;
+        if (++in->_count <= inner_slots) {
+            return;
+        }
+
+        /* the middle key moves up, the right half goes to a new node */
+        unsigned mid = in->_count / 2;
+        inner *r = new_inner();
+        r->_count = in->_count - mid - 1;
+        for (unsigned i = 0; i < r->_count; i++) {
+            r->_keys[i] = std::move(in->_keys[mid + 1 + i]);
+            r->_children[i] = in->_children[mid + 1 + i];
+        }
+        r->_children[r->_count] = in->_children[in->_count];
+        in->_count = mid;
+        insert_parent(p, d - 1, in, in->_keys[mid], r);
+    }
+
+    void insert_at(path &p, leaf *l, unsigned pos, const key_type &key, value_type *elm) {
+        for (unsigned i = l->_count; i > pos; i--) {
+            l->_keys[i] = std::move(l->_keys[i - 1]);
+            l->_values[i] = l->_values[i - 1];
+        }
+        l->_keys[pos] = key;
+        l->_values[pos] = elm;
+        _count++;
+        if (++l->_count <= leaf_slots) {
+            return;
+        }
+
+        unsigned mid = l->_count / 2;
+        leaf *r = new_leaf();
+        r->_count = l->_count - mid;
+        for (unsigned i = 0; i < r->_count; i++) {
+            r->_keys[i] = std::move(l->_keys[mid + i]);
+            r->_values[i] = l->_values[mid + i];
+        }
+        l->_count = mid;
+
+        r->_prev = l;
+        r->_next = l->_next;
+        if (l->_next) {
+            l->_next->_prev = r;
+        }
+        else {
+            _last = r;
+        }
+        l->_next = r;
+
+        key_type sep = r->_keys[0];
+        insert_parent(p, _height, l, sep, r);
+    }
+
+    /* drops key pos and the child after it */
+    static void inner_erase(inner *in, unsigned pos) {
+        for (unsigned i = pos; i + 1 < in->_count; i++) {
+            in->_keys[i] = std::move(in->_keys[i + 1]);
+            in->_children[i + 1] = in->_children[i + 2];
+        }
+        in->_count--;
+    }
+
+    void rebalance_inner(path &p, unsigned d, inner *n) {
+        if (!d) {
+            if (!n->_count) {
+                _root = n->_children[0];
+                _height--;
+                free_node(n);
+            }
+            return;
+        }
+        if (n->_count >= inner_min) {
+            return;
+        }
+
+        inner *in = p._nodes[d - 1];
+        unsigned pos = p._pos[d - 1];
+        unsigned sep = pos ? pos - 1 : pos;
+        inner *left = static_cast<inner*>(in->_children[sep]);
+        inner *right = static_cast<inner*>(in->_children[sep + 1]);
+
+        if (left->_count + right->_count + 1 <= inner_slots) {
+            left->_keys[left->_count] = std::move(in->_keys[sep]);
+            for (unsigned i = 0; i < right->_count; i++) {
+                left->_keys[left->_count + 1 + i] = std::move(right->_keys[i]);
+                left->_children[left->_count + 1 + i] = right->_children[i];
+            }
+            left->_children[left->_count + 1 + right->_count] = right->_children[right->_count];
+            left->_count += right->_count + 1;
+            free_node(right);
+            inner_erase(in, sep);
+            rebalance_inner(p, d - 1, in);
+            return;
+        }
+
+        /* rotate through the separator until the two are even */
+        while (left->_count + 1 < right->_count) {
+            left->_keys[left->_count] = std::move(in->_keys[sep]);
+            left->_children[left->_count + 1] = right->_children[0];
+            left->_count++;
+            in->_keys[sep] = std::move(right->_keys[0]);
+            for (unsigned i = 0; i + 1 < right->_count; i++) {
+                right->_keys[i] = std::move(right->_keys[i + 1]);
+                right->_children[i] = right->_children[i + 1];
+            }
+            right->_children[right->_count - 1] = right->_children[right->_count];
+            right->_count--;
+        }
+        while (right->_count + 1 < left->_count) {
+            for (unsigned i = right->_count; i > 0; i--) {
+                right->_keys[i] = std::move(right->_keys[i - 1]);
+                right->_children[i + 1] = right->_children[i];
+            }
+            right->_children[1] = right->_children[0];
+            right->_keys[0] = std::move(in->_keys[sep]);
+            right->_children[0] = left->_children[left->_count];
+            right->_count++;
+            in->_keys[sep] = std::move(left->_keys[left->_count - 1]);
+            left->_count--;
+        }
+    }
+
+    /* l may be short by any number of entries, e.g. after a range erase */
+    void rebalance_leaf(path &p, leaf *l) {
+        if (!_height || l->_count >= leaf_min) {
+            return;
+        }
+
+        inner *in = p._nodes[_height - 1];
+        unsigned pos = p._pos[_height - 1];
+        unsigned sep = pos ? pos - 1 : pos;
+        leaf *left = static_cast<leaf*>(in->_children[sep]);
+        leaf *right = static_cast<leaf*>(in->_children[sep + 1]);
+
+        if (left->_count + right->_count <= leaf_slots) {
+            for (unsigned i = 0; i < right->_count; i++) {
+                left->_keys[left->_count + i] = std::move(right->_keys[i]);
+                left->_values[left->_count + i] = right->_values[i];
+            }
+            left->_count += right->_count;
+            left->_next = right->_next;
+            if (right->_next) {
+                right->_next->_prev = left;
+            }
+            else {
+                _last = left;
+            }
+            free_node(right);
+            inner_erase(in, sep);
+            rebalance_inner(p, _height - 1, in);
+            return;
+        }
+
+        unsigned total = left->_count + right->_count;
+        unsigned n = total / 2;
+        if (left->_count < n) {
+            unsigned move = n - left->_count;
+            for (unsigned i = 0; i < move; i++) {
+                left->_keys[left->_count + i] = std::move(right->_keys[i]);
+                left->_values[left->_count + i] = right->_values[i];
+            }
+            for (unsigned i = move; i < right->_count; i++) {
+                right->_keys[i - move] = std::move(right->_keys[i]);
+                right->_values[i - move] = right->_values[i];
+            }
+        }
+        else {
+            unsigned move = left->_count - n;
+            for (unsigned i = right->_count; i > 0; i--) {
+                right->_keys[i - 1 + move] = std::move(right->_keys[i - 1]);
+                right->_values[i - 1 + move] = right->_values[i - 1];
+            }
+            for (unsigned i = 0; i < move; i++) {
+                right->_keys[i] = std::move(left->_keys[n + i]);
+                right->_values[i] = left->_values[n + i];
+            }
+        }
+        left->_count = n;
+        right->_count = total - n;
+        in->_keys[sep] = right->_keys[0];
+    }
+
+    /* removes [first, last) from l, returns the number removed */
+    template <typename _F>
+    unsigned leaf_erase(leaf *l, unsigned first, unsigned last, _F &&f) {
+        for (unsigned i = first; i < last; i++) {
+            f(l->_values[i]);
+        }
+        unsigned n = last - first;
+        for (unsigned i = last; i < l->_count; i++) {
+            l->_keys[i - n] = std::move(l->_keys[i]);
+            l->_values[i - n] = l->_values[i];
+        }
+        l->_count -= n;
+        _count -= n;
+        return n;
+    }
+
+public:
+    class iterator {
+        friend class btree;
+    private:
+        btree *_tree;
+        leaf *_leaf;
+        unsigned _pos;
+
+        iterator(btree *tree, leaf *l, unsigned pos) noexcept : _tree(tree), _leaf(l), _pos(pos) {
+            if (_leaf && _pos == _leaf->_count) {
+                _leaf = _leaf->_next;
+                _pos = 0;
+            }
+        }
+    public:
+        iterator() noexcept : _tree(), _leaf(), _pos() {}
+
+        value_type& operator*() noexcept {
+            return *_leaf->_values[_pos];
+        }
+
+        value_type* operator->() noexcept {
+            return _leaf->_values[_pos];
+        }
+
+        value_type* pointer() noexcept {
+            return _leaf->_values[_pos];
+        }
+
+        const key_type &key() const noexcept {
+            return _leaf->_keys[_pos];
+        }
+
+        iterator& operator++() noexcept {
+            if (++_pos == _leaf->_count) {
+                _leaf = _leaf->_next;
+                _pos = 0;
+            }
+            return *this;
+        }
+
+        iterator operator++(int) noexcept {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        /* end() steps back to the last value */
+        iterator& operator--() noexcept {
+            if (!_leaf) {
+                _leaf = _tree->_count ? _tree->_last : nullptr;
+                _pos = _leaf ? _leaf->_count : 0;
+            }
+            else if (!_pos) {
+                _leaf = _leaf->_prev;
+                _pos = _leaf ? _leaf->_count : 0;
+            }
+            if (_leaf) {
+                _pos--;
+            }
+            return *this;
+        }
+
+        iterator operator--(int) noexcept {
+            iterator tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        bool operator==(const iterator &other) const noexcept {
+            return _leaf == other._leaf && _pos == other._pos;
+        }
+
+        bool operator!=(const iterator &other) const noexcept {
+            return !(*this == other);
+        }
+    };
+
+    btree(allocator_type *allocator) noexcept : _allocator(allocator), _count(0), _height(0) {
+        _root = _first = _last = new_leaf();
+    }
+
+    btree(const btree&) = delete;
+    btree &operator=(const btree&) = delete;
+
+    ~btree() noexcept {
+        free_tree(_root);
+    }
+
+    size_t count() const noexcept {
+        return _count;
+    }
+
+    bool empty() const noexcept {
+        return !_count;
+    }
+
+    unsigned height() const noexcept {
+        return _height + 1;
+    }
+
+    /* drops every value, the values themselves are the caller's */
+    void clear() noexcept {
+        free_tree(_root);
+        _root = _first = _last = new_leaf();
+        _count = 0;
+        _height = 0;
+    }
+
+    value_type *front() noexcept {
+        return _count ? _first->_values[0] : nullptr;
+    }
+
+    value_type *back() noexcept {
+        return _count ? _last->_values[_last->_count - 1] : nullptr;
+    }
+
+    value_type *get(key_type key) noexcept {
+        leaf *l = find_leaf(key, nullptr);
+        unsigned i = lower(l->_keys, l->_count, key);
+        if (i < l->_count && !compare_type::compare(l->_keys[i], key)) {
+            return l->_values[i];
+        }
+        return nullptr;
+    }
+
+    template <typename ...Args>
+    value_type *probe(key_type key, int *flag, Args &&... args) noexcept {
+        path p;
+        leaf *l = find_leaf(key, &p);
+        unsigned i = lower(l->_keys, l->_count, key);
+        if (i < l->_count && !compare_type::compare(l->_keys[i], key)) {
+            if (flag) {
+                *flag = 0;
+            }
+            return l->_values[i];
+        }
+
+        value_type *elm = _new<value_type>(*_allocator, key, std::forward<Args>(args)...);
+        insert_at(p, l, i, key, elm);
+        if (flag) {
+            *flag = 1;
+        }
+        return elm;
+    }
+
+    /* returns new_elm, or the element already holding its key */
+    value_type *insert(value_type *new_elm) noexcept {
+        key_type key = getkey_type::get_key(new_elm);
+        path p;
+        leaf *l = find_leaf(key, &p);
+        unsigned i = lower(l->_keys, l->_count, key);
+        if (i < l->_count && !compare_type::compare(l->_keys[i], key)) {
+            return l->_values[i];
+        }
+        insert_at(p, l, i, key, new_elm);
+        return new_elm;
+    }
+
+    /* returns the element new_elm took the place of, or nullptr if it was added */
+    value_type *replace(value_type *new_elm) noexcept {
+        key_type key = getkey_type::get_key(new_elm);
+        path p;
+        leaf *l = find_leaf(key, &p);
+        unsigned i = lower(l->_keys, l->_count, key);
+        if (i < l->_count && !compare_type::compare(l->_keys[i], key)) {
+            value_type *elm = l->_values[i];
+            l->_values[i] = new_elm;
+            return elm;
+        }
+        insert_at(p, l, i, key, new_elm);
+        return nullptr;
+    }
+
+    value_type *remove(key_type key) noexcept {
+        path p;
+        leaf *l = find_leaf(key, &p);
+        unsigned i = lower(l->_keys, l->_count, key);
+        if (i == l->_count || compare_type::compare(l->_keys[i], key)) {
+            return nullptr;
+        }
+        value_type *elm = l->_values[i];
+        leaf_erase(l, i, i + 1, [](value_type*) {});
+        rebalance_leaf(p, l);
+        return elm;
+    }
+
+    value_type *remove(value_type *elm) noexcept {
+        return remove(getkey_type::get_key(elm));
+    }
+
+    /* removes the keys in [first, last), f(value_type*) sees each one leave.
+     * whole runs are cut out of a leaf at a time. */
+    template <typename _F>
+    size_t remove(key_type first, key_type last, _F &&f) noexcept {
+        size_t n = 0;
+        key_type key = first;
+        while (1) {
+            path p;
+            leaf *l = find_leaf(key, &p);
+            unsigned i = lower(l->_keys, l->_count, key);
+            if (i == l->_count) {
+                if (!l->_next) {
+                    break;
+                }
+                /* the range starts in the next leaf, go down again for its path */
+                key = l->_next->_keys[0];
+                continue;
+            }
+            unsigned j = i + lower(l->_keys + i, l->_count - i, last);
+            if (i == j) {
+                break;
+            }
+            bool more = j == l->_count;
+            n += leaf_erase(l, i, j, f);
+            rebalance_leaf(p, l);
+            if (!more) {
+                break;
+            }
+        }
+        return n;
+    }
+
+    size_t remove(key_type first, key_type last) noexcept {
+        return remove(first, last, [](value_type*) {});
+    }
+
+    iterator lower_bound(key_type key) noexcept {
+        leaf *l = find_leaf(key, nullptr);
+        return iterator(this, l, lower(l->_keys, l->_count, key));
+    }
+
+    iterator upper_bound(key_type key) noexcept {
+        leaf *l = find_leaf(key, nullptr);
+        return iterator(this, l, upper(l->_keys, l->_count, key));
+    }
+
+    iterator begin() noexcept {
+        return iterator(this, _count ? _first : nullptr, 0);
+    }
+
+    iterator end() noexcept {
+        return iterator(this, nullptr, 0);
+    }
+};
+
+}
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef __LIBLLPP_CLOSURE_H__
 #define __LIBLLPP_CLOSURE_H__
 
+#include <cstddef>
+#include <type_traits>
+
 #include "functor.h"
 #include "construct.h"
 
@@ -115,8 +118,77 @@ closure<_R(_Args...)>::_new(_Allocator &&a, _T &&fn, _Params&&...params) noexcep
         std::forward<_Params>(params)...);
 }
 
-}
+/* holds one closure, built in place when its functor fits in __size bytes and
+ * on the allocator otherwise. a member function bound to an object, or a lambda
+ * capturing a few pointers, fits the default.
+ * the owner resets it with the allocator it was set with. */
+template <typename _Sig, size_t __size = 4 * sizeof(void*)>
+class inline_closure;
 
-#endif
+template <size_t __size, typename _R, typename ..._Args>
+class inline_closure<_R(_Args...), __size> {
+public:
+    typedef _R signature(_Args...);
+    typedef closure<signature> closure_type;
+    static constexpr size_t capacity = sizeof(closure_type) + __size;
+
+private:
+    closure_type *_closure;
+    typename std::aligned_storage<capacity, alignof(void*)>::type _storage;
+
+    bool is_inline() const noexcept {
+        return (const void*)_closure == (const void*)&_storage;
+    }
+
+public:
+    inline_closure() noexcept : _closure() {}
+    inline_closure(const inline_closure&) = delete;
+    inline_closure &operator=(const inline_closure&) = delete;
+
+    template <typename _Allocator, typename _T, typename ..._Params>
+    void set(_Allocator &&a, _T &&fn, _Params&&...params) noexcept {
+        typedef decltype(make_functor<signature>(std::forward<_T>(fn), std::forward<_Params>(params)...)) functor_type;
+        typedef closure_impl<signature, functor_type> type;
+
+        reset(a);
+        if (sizeof(type) <= capacity && alignof(type) <= alignof(void*)) {
+            _closure = construct<type>(&_storage, std::forward<_T>(fn), std::forward<_Params>(params)...);
+        }
+        else {
+            _closure = closure_type::_new(std::forward<_Allocator>(a), std::forward<_T>(fn), std::forward<_Params>(params)...);
+        }
+    }
+
+    template <typename _Allocator>
+    void reset(_Allocator &&a) noexcept {
+        if (_closure) {
+            if (is_inline()) {
+                closure_type::destruct(_closure);
+            }
+            else {
+                closure_type::_delete(std::forward<_Allocator>(a), _closure);
+            }
+            _closure = nullptr;
+        }
+    }
+
+    closure_type *get() noexcept {
+        return _closure;
+    }
+
+    explicit operator bool() const noexcept {
+        return _closure != nullptr;
+    }
+
+    _R apply(_Args... args) noexcept {
+        return _closure->apply(std::forward<_Args>(args)...);
+    }
 
+    _R operator()(_Args... args) noexcept {
+        return _closure->apply(std::forward<_Args>(args)...);
+    }
+};
 
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include "connection.h"
+
+namespace ll {
+
+static constexpr unsigned connection_poll_flags = reactor::poll_in | reactor::poll_err | reactor::poll_hup;
+
+connection::connection(reactor *reactor, timer_manager *timermgr, page_allocator *pa) noexcept :
+    signal<int(connection&, int), true>(),
+    _reactor(reactor),
+    _timermgr(timermgr),
+    _fd(-1),
+    _input(pa),
+    _output(pa),
+    _high_watermark(default_high_watermark),
+    _low_watermark(default_low_watermark),
+    _flush_timer(),
+    _poll_out(false),
+    _full(false)
+{
+}
+
+connection::~connection() noexcept
+{
+    close();
+}
+
+inline void connection::close_flush_timer()
+{
+    if (_flush_timer) {
+        _timermgr->remove(_flush_timer);
+        _flush_timer = nullptr;
+    }
+}
+
+int connection::set_poll_out(bool on)
+{
+    if (_poll_out == on) {
+        return ok;
+    }
+
+    ll_failed_return(_reactor->modify(_fd, on ? (connection_poll_flags | reactor::poll_out) : connection_poll_flags));
+    _poll_out = on;
+    return ok;
+}
+
+int connection::open(int fd)
+{
+    if (opened()) {
+        return e_busy;
+    }
+
+    ll_failed_return(_reactor->open(fd, connection_poll_flags, &connection::io_handler, this));
+    _fd = fd;
+    _poll_out = false;
+    _full = false;
+    return ok;
+}
+
+void connection::close()
+{
+    close_flush_timer();
+    if (opened()) {
+        _reactor->close(_fd);
+    }
+}
+
+int connection::io_handler(file_io &io, int type)
+{
+    if (type & reactor::poll_close) {
+        close_flush_timer();
+        io.close();
+        _fd = -1;
+        _input.clear();
+        _output.clear();
+        emit(*this, ev_close);
+        return ok;
+    }
+
+    if (type & reactor::poll_err) {
+        return fail;
+    }
+
+    if (type & reactor::poll_out) {
+        close_flush_timer();
+        ll_failed_return(flush());
+    }
+
+    if (type & (reactor::poll_in | reactor::poll_hup)) {
+        int n = _input.load(_fd);
+        if (_input.size()) {
+            ll_failed_return(emit(*this, ev_read));
+        }
+        ll_failed_return(n);
+    }
+    return ok;
+}
+
+void connection::flush_handler()
+{
+    _flush_timer = nullptr;
+    if (ll_failed(flush())) {
+        _reactor->close(_fd);
+    }
+}
+
+int connection::write(const void *buf, size_t size)
+{
+    if (!opened()) {
+        return e_closed;
+    }
+
+    if (!size) {
+        return ok;
+    }
+
+    _output.write(buf, size);
+
+    /* while poll_out is armed the kernel buffer is full, the reactor flushes */
+    if (!_flush_timer && !_poll_out) {
+        _flush_timer = _timermgr->idle(&connection::flush_handler, this);
+    }
+
+    if (!_full && _output.size() >= _high_watermark) {
+        _full = true;
+        ll_failed_return(emit(*this, ev_full));
+    }
+    return size;
+}
+
+int connection::flush()
+{
+    if (_output.size()) {
+        ll_failed_return(_output.output(_fd));
+    }
+
+    ll_failed_return(set_poll_out(_output.size() != 0));
+
+    if (_full && _output.size() <= _low_watermark) {
+        _full = false;
+        ll_failed_return(emit(*this, ev_drain));
+    }
+    return ok;
+}
+
+}
+
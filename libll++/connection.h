@@ -0,0 +1,105 @@
+#ifndef __LIBLLPP_CONNECTION_H__
+#define __LIBLLPP_CONNECTION_H__
+
+#include "reactor.h"
+#include "timer_manager.h"
+#include "stream.h"
+
+namespace ll {
+
+class connection : public signal<int(connection&, int), true> {
+public:
+    static constexpr unsigned ev_read                   = (1 << 0);
+    static constexpr unsigned ev_full                   = (1 << 1);
+    static constexpr unsigned ev_drain                  = (1 << 2);
+    static constexpr unsigned ev_close                  = (1 << 3);
+
+    static constexpr size_t default_high_watermark      = 1024 * 1024;
+    static constexpr size_t default_low_watermark       = 64 * 1024;
+
+private:
+    reactor *_reactor;
+    timer_manager *_timermgr;
+    int _fd;
+    stream _input;
+    stream _output;
+    size_t _high_watermark;
+    size_t _low_watermark;
+    timer *_flush_timer;
+    bool _poll_out;
+    bool _full;
+
+    int io_handler(file_io&, int type);
+    void flush_handler();
+    int set_poll_out(bool on);
+    void close_flush_timer();
+public:
+    connection(reactor *reactor, timer_manager *timermgr, page_allocator *pa = nullptr) noexcept;
+    ~connection() noexcept;
+
+    reactor *get_reactor() {
+        return _reactor;
+    }
+
+    timer_manager *get_timer_manager() {
+        return _timermgr;
+    }
+
+    int get_fd() {
+        return _fd;
+    }
+
+    bool opened() {
+        return ll_fd_valid(_fd);
+    }
+
+    stream &input() {
+        return _input;
+    }
+
+    stream &output() {
+        return _output;
+    }
+
+    /* bytes written but not yet accepted by the kernel */
+    size_t backlog() {
+        return _output.size();
+    }
+
+    /* false between crossing the high watermark and draining below the low one */
+    bool writable() {
+        return !_full;
+    }
+
+    size_t get_high_watermark() {
+        return _high_watermark;
+    }
+
+    size_t get_low_watermark() {
+        return _low_watermark;
+    }
+
+    void set_watermarks(size_t high, size_t low) {
+        assert(low <= high);
+        _high_watermark = high;
+        _low_watermark = low;
+    }
+
+    int open(int fd);
+    void close();
+
+    /* buffer size bytes, the data is sent by one flush per loop iteration */
+    int write(const void *buf, size_t size);
+    int flush();
+
+    template <typename _F, typename ..._Args>
+    int open(int fd, _F &&f, _Args&&...args) {
+        connect(std::forward<_F>(f), std::forward<_Args>(args)...);
+        return open(fd);
+    }
+};
+
+}
+
+#endif
+
@@ -0,0 +1,360 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "connection_pool.h"
+
+namespace ll {
+
+connection_pool::connection_pool(address &addr, reactor *reactor, timer_manager *timermgr) noexcept :
+    _reactor(reactor),
+    _timermgr(timermgr),
+    _idle(),
+    _spares(),
+    _waiters(),
+    _pendings(),
+    _finished(),
+    _idle_count(),
+    _active_count(),
+    _connecting_count(),
+    _waiting_count(),
+    _min_idle(),
+    _max_idle(default_max_idle),
+    _max_conns(default_max_conns),
+    _max_connecting(default_max_connecting),
+    _connect_timeout(),
+    _wait_timeout(),
+    _idle_timeout(),
+    _keepalive_interval(),
+    _keepalive_timer(),
+    _reap_timer(),
+    _probe()
+{
+    _addr = addr;
+}
+
+connection_pool::~connection_pool() noexcept
+{
+    close();
+    if (_reap_timer) {
+        _timermgr->remove(_reap_timer);
+        _reap_timer = nullptr;
+    }
+    reap_handler();
+
+    conn *c;
+    while ((c = _spares.pop_front())) {
+        _delete<conn>(nullptr, c);
+    }
+}
+
+void connection_pool::close()
+{
+    conn *c;
+    pending *p;
+
+    if (_keepalive_timer) {
+        _timermgr->remove(_keepalive_timer);
+        _keepalive_timer = nullptr;
+    }
+
+    while ((c = _idle.front())) {
+        drop(c);
+    }
+
+    while ((p = _pendings.front())) {
+        p->_connector.close();
+        finish(p);
+    }
+
+    while (_waiting_count) {
+        fail_waiter(e_closed);
+    }
+}
+
+void connection_pool::set_keepalive(unsigned min_idle, timeval interval)
+{
+    _min_idle = min_idle;
+    _keepalive_interval = time_prec_msec::adjust(interval);
+
+    if (_keepalive_timer) {
+        _timermgr->remove(_keepalive_timer);
+        _keepalive_timer = nullptr;
+    }
+
+    if (_keepalive_interval) {
+        _keepalive_timer = _timermgr->schedule_r(_keepalive_interval, &connection_pool::keepalive_handler, this);
+    }
+
+    while (_idle_count + _connecting_count < _min_idle && ll_ok(start_connect()));
+}
+
+inline void connection_pool::close_fd(int fd)
+{
+    file_io::close(fd);
+}
+
+/* an idle connection must be silent: eof, unsolicited data, a hangup or an
+ * error all mean stale, failing here has the reactor close it */
+int connection_pool::idle_handler(conn *c, file_io &io, int type)
+{
+    if (type & reactor::poll_close) {
+        if (c->_idle) {
+            _idle.remove(c);
+            _idle_count--;
+            c->_idle = false;
+            _spares.push_front(c);
+            io.close();
+        }
+        return ok;
+    }
+    return fail;
+}
+
+void connection_pool::park(int fd)
+{
+    conn *c = _spares.pop_front();
+    if (!c) {
+        c = _new<conn>(nullptr);
+    }
+
+    if (ll_failed(_reactor->open(fd, reactor::poll_in | reactor::poll_hup | reactor::poll_err,
+                                 &connection_pool::idle_handler, this, c))) {
+        _spares.push_front(c);
+        close_fd(fd);
+        return;
+    }
+    c->_fd = fd;
+    c->_since = time_prec_msec::now();
+    c->_idle = true;
+    _idle.push_front(c);
+    _idle_count++;
+}
+
+/* the reactor lets go of the fd without closing it */
+int connection_pool::unpark(conn *c)
+{
+    _idle.remove(c);
+    _idle_count--;
+    c->_idle = false;
+    _spares.push_front(c);
+    _reactor->close(c->_fd);
+    return c->_fd;
+}
+
+inline void connection_pool::drop(conn *c)
+{
+    close_fd(unpark(c));
+}
+
+void connection_pool::finish(pending *p)
+{
+    p->_done = true;
+    _pendings.remove(p);
+    _finished.push_back(p);
+    _connecting_count--;
+
+    /* the connector is still emitting, free it from the next idle run */
+    if (!_reap_timer) {
+        _reap_timer = _timermgr->idle(&connection_pool::reap_handler, this);
+    }
+}
+
+void connection_pool::reap_handler()
+{
+    pending *p;
+    _reap_timer = nullptr;
+    while ((p = _finished.pop_front())) {
+        _delete<pending>(nullptr, p);
+    }
+}
+
+int connection_pool::connect_handler(pending *p, connector&, int fd, int type)
+{
+    if (p->_done) {
+        return fail;
+    }
+
+    if (type & reactor::poll_out) {
+        finish(p);
+
+        int n = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &n, sizeof(int));
+        hand(fd);
+        maybe_connect();
+        return ok;
+    }
+
+    if (type & reactor::poll_err) {
+        finish(p);
+        if (_waiting_count > _connecting_count) {
+            fail_waiter(fail);
+        }
+        return fail;
+    }
+
+    return ok;
+}
+
+int connection_pool::start_connect()
+{
+    if (_idle_count + _active_count + _connecting_count >= _max_conns ||
+        _connecting_count >= _max_connecting) {
+        return e_busy;
+    }
+
+    pending *p = _new<pending>(nullptr, _addr, _reactor, _timermgr, _connect_timeout);
+    _pendings.push_back(p);
+    _connecting_count++;
+
+    if (ll_failed(p->_connector.connect(&connection_pool::connect_handler, this, p))) {
+        if (!p->_done) {
+            finish(p);
+            if (_waiting_count > _connecting_count) {
+                fail_waiter(fail);
+            }
+        }
+        return fail;
+    }
+    return ok;
+}
+
+void connection_pool::maybe_connect()
+{
+    while (_waiting_count > _connecting_count) {
+        if (ll_failed(start_connect())) {
+            break;
+        }
+    }
+}
+
+void connection_pool::hand(int fd)
+{
+    waiter *w = _waiters.pop_front();
+    if (!w) {
+        if (_idle_count >= _max_idle && _idle_count >= _min_idle) {
+            close_fd(fd);
+            return;
+        }
+        park(fd);
+        return;
+    }
+
+    _waiting_count--;
+    if (w->_timer) {
+        _timermgr->remove(w->_timer);
+    }
+
+    _active_count++;
+    closure_type *c = w->_closure;
+    _delete<waiter>(nullptr, w);
+    if (ll_failed(c->apply(*this, fd))) {
+        release(fd, false);
+    }
+    _delete<closure_type>(nullptr, c);
+}
+
+void connection_pool::fail_waiter(int err)
+{
+    waiter *w = _waiters.pop_front();
+    if (!w) {
+        return;
+    }
+
+    _waiting_count--;
+    if (w->_timer) {
+        _timermgr->remove(w->_timer);
+    }
+
+    closure_type *c = w->_closure;
+    _delete<waiter>(nullptr, w);
+    c->apply(*this, err);
+    _delete<closure_type>(nullptr, c);
+}
+
+timeval connection_pool::wait_expired(waiter *w, timer&, timeval)
+{
+    w->_timer = nullptr;
+    _waiters.remove(w);
+    _waiting_count--;
+
+    closure_type *c = w->_closure;
+    _delete<waiter>(nullptr, w);
+    c->apply(*this, e_timedout);
+    _delete<closure_type>(nullptr, c);
+    return 0;
+}
+
+timeval connection_pool::keepalive_handler(timer&, timeval curtime)
+{
+    conn *c;
+
+    /* evict from the cold end, the list is kept in LIFO order */
+    while (_idle_count > _min_idle && (c = _idle.back()) && 
+           _idle_timeout && curtime - c->_since >= _idle_timeout) {
+        drop(c);
+    }
+
+    /* dead connections are reported by the reactor, this is the application's check */
+    auto end = _idle.end();
+    for (auto it = _idle.begin(); it != end;) {
+        c = it.pointer();
+        ++it;
+        if (ll_failed(_probe.emit(*this, c->_fd))) {
+            drop(c);
+        }
+    }
+
+    while (_idle_count + _connecting_count < _min_idle && ll_ok(start_connect()));
+    return _keepalive_interval;
+}
+
+int connection_pool::acquire()
+{
+    conn *c = _idle.front();
+    if (!c) {
+        return e_notready;
+    }
+    _active_count++;
+    return unpark(c);
+}
+
+int connection_pool::do_acquire(closure_type *c)
+{
+    int fd = acquire();
+    if (ll_ok(fd)) {
+        int n = c->apply(*this, fd);
+        _delete<closure_type>(nullptr, c);
+        if (ll_failed(n)) {
+            release(fd, false);
+        }
+        return n;
+    }
+
+    waiter *w = _new<waiter>(nullptr);
+    w->_closure = c;
+    if (_wait_timeout) {
+        w->_timer = _timermgr->schedule_r(_wait_timeout, &connection_pool::wait_expired, this, w);
+    }
+    _waiters.push_back(w);
+    _waiting_count++;
+
+    /* served by a new connect or a release, or failed by either */
+    maybe_connect();
+    return ok;
+}
+
+void connection_pool::release(int fd, bool reuse)
+{
+    assert(_active_count);
+    _active_count--;
+
+    if (!reuse) {
+        close_fd(fd);
+        maybe_connect();
+        return;
+    }
+    hand(fd);
+}
+
+}
+
@@ -0,0 +1,157 @@
+#ifndef __LIBLLPP_CONNECTION_POOL_H__
+#define __LIBLLPP_CONNECTION_POOL_H__
+
+#include "socket.h"
+
+namespace ll {
+
+class connection_pool {
+public:
+    typedef closure<int(connection_pool&, int)> closure_type;
+
+    static constexpr unsigned default_max_conns         = 64;
+    static constexpr unsigned default_max_idle          = 16;
+    static constexpr unsigned default_max_connecting    = 4;
+
+private:
+    /* the pool's hold on a connected fd while it is idle, watched by the
+     * reactor. kept as a spare once the fd is checked out, so release()
+     * does not allocate */
+    struct conn {
+        clist_entry _entry;
+        int _fd;
+        timeval _since;
+        bool _idle;
+        conn() : _entry(nullptr), _fd(-1), _since(), _idle(false) {}
+    };
+
+    /* a checkout that could not be served from the idle list */
+    struct waiter {
+        clist_entry _entry;
+        closure_type *_closure;
+        timer *_timer;
+        waiter() : _entry(nullptr), _closure(), _timer() {}
+    };
+
+    /* an in-flight connect, freed from an idle callback once it finished */
+    struct pending {
+        clist_entry _entry;
+        connector _connector;
+        bool _done;
+        pending(address &addr, reactor *reactor, timer_manager *timermgr, timeval timeout) :
+            _entry(nullptr), _connector(addr, reactor, timermgr, timeout, 0), _done(false) {}
+    };
+
+    address _addr;
+    reactor *_reactor;
+    timer_manager *_timermgr;
+    ll_list(conn, _entry) _idle;
+    ll_list(conn, _entry) _spares;
+    ll_list(waiter, _entry) _waiters;
+    ll_list(pending, _entry) _pendings;
+    ll_list(pending, _entry) _finished;
+    unsigned _idle_count;
+    unsigned _active_count;
+    unsigned _connecting_count;
+    unsigned _waiting_count;
+    unsigned _min_idle;
+    unsigned _max_idle;
+    unsigned _max_conns;
+    unsigned _max_connecting;
+    timeval _connect_timeout;
+    timeval _wait_timeout;
+    timeval _idle_timeout;
+    timeval _keepalive_interval;
+    timer *_keepalive_timer;
+    timer *_reap_timer;
+    signal<int(connection_pool&, int), true> _probe;
+
+    int connect_handler(pending *p, connector&, int fd, int type);
+    int idle_handler(conn *c, file_io &io, int type);
+    timeval wait_expired(waiter *w, timer&, timeval);
+    timeval keepalive_handler(timer&, timeval);
+    void reap_handler();
+    void finish(pending *p);
+    int start_connect();
+    void maybe_connect();
+    void hand(int fd);
+    void park(int fd);
+    int unpark(conn *c);
+    void drop(conn *c);
+    void fail_waiter(int err);
+    void close_fd(int fd);
+    int do_acquire(closure_type *c);
+
+public:
+    connection_pool(address &addr, reactor *reactor, timer_manager *timermgr) noexcept;
+    ~connection_pool() noexcept;
+
+    address &get_addr() {
+        return _addr;
+    }
+
+    unsigned idle_count() {
+        return _idle_count;
+    }
+
+    unsigned active_count() {
+        return _active_count;
+    }
+
+    unsigned connecting_count() {
+        return _connecting_count;
+    }
+
+    unsigned waiting_count() {
+        return _waiting_count;
+    }
+
+    void set_limits(unsigned max_conns, unsigned max_idle, unsigned max_connecting) {
+        _max_conns = max_conns ? max_conns : default_max_conns;
+        _max_idle = max_idle;
+        _max_connecting = max_connecting ? max_connecting : default_max_connecting;
+    }
+
+    void set_connect_timeout(timeval value) {
+        _connect_timeout = time_prec_msec::adjust(value);
+    }
+
+    void set_wait_timeout(timeval value) {
+        _wait_timeout = time_prec_msec::adjust(value);
+    }
+
+    /* idle connections beyond min_idle are closed after idle_timeout */
+    void set_idle_timeout(timeval value) {
+        _idle_timeout = time_prec_msec::adjust(value);
+    }
+
+    /* keep min_idle connections warm, probing idle ones every interval */
+    void set_keepalive(unsigned min_idle, timeval interval);
+
+    /* application level health check, fail to drop the idle connection */
+    template <typename _F, typename ..._Args>
+    void set_probe(_F &&f, _Args&&...args) {
+        _probe.connect(std::forward<_F>(f), std::forward<_Args>(args)...);
+    }
+
+    /* take an idle connection, e_notready if none is available right now.
+     * the fd is non-blocking and no longer watched by the reactor */
+    int acquire();
+
+    /* call f(pool, fd) with a connection, now or once one is connected,
+     * fd is negative if connecting or waiting failed */
+    template <typename _F, typename ..._Args>
+    int acquire(_F &&f, _Args&&...args) {
+        return do_acquire(_new<closure_type>(nullptr, std::forward<_F>(f), std::forward<_Args>(args)...));
+    }
+
+    /* give fd back, the most recently released fd is checked out first */
+    void release(int fd, bool reuse = true);
+
+    void close();
+};
+
+}
+
+#endif
+
@@ -8,16 +8,12 @@
 
 namespace ll {
 
-MEMBER_CHECKER_DECL(free_checker, free);
-template <typename _T, typename = std::false_type, typename = std::false_type>
+/* an allocator that takes memory back declares static constexpr bool has_free = true */
+template <typename _T, typename = std::true_type>
 struct has_free : std::false_type {};
 
 template <typename _T>
-struct has_free<
-    _T, 
-    typename free_checker<_T>::has_function,
-    typename free_checker<typename member_of<decltype(&_T::free)>::class_type>::
-        template has_signature<void(void*, size_t)>> : std::true_type {};
+struct has_free<_T, std::integral_constant<bool, _T::has_free>> : std::true_type {};
 
 template <typename _T, typename ..._Args>
 inline _T *construct(void *p, _Args&&...args) noexcept {
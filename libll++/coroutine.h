@@ -0,0 +1,380 @@
+#ifndef __LIBLLPP_COROUTINE_H__
+#define __LIBLLPP_COROUTINE_H__
+
+/* c++20 only, the rest of the library stays c++11 */
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <exception>
+
+#include "memory.h"
+#include "reactor.h"
+#include "timer_manager.h"
+#include "socket.h"
+#include "connection.h"
+
+namespace ll {
+
+/* a coroutine started by its call and freed at its end, nothing awaits it.
+ * the frame comes from the first pool* parameter, or from the global allocator,
+ * so a per-connection coroutine passes the connection's pool. */
+class task {
+public:
+    struct promise_type {
+    private:
+        /* in front of the frame, pool frames go with their pool */
+        struct header {
+            pool *_pool;
+            size_t _pad;
+        };
+
+        static pool *find_pool() noexcept {
+            return nullptr;
+        }
+
+        template <typename ..._Rest>
+        static pool *find_pool(pool *&p, _Rest&...) noexcept {
+            return p;
+        }
+
+        template <typename _T, typename ..._Rest>
+        static pool *find_pool(_T&, _Rest&...rest) noexcept {
+            return find_pool(rest...);
+        }
+
+    public:
+        template <typename ..._Args>
+        static void *operator new(size_t size, _Args&...args) noexcept {
+            pool *p = find_pool(args...);
+            header *h = (header*)(p ? p->alloc(sizeof(header) + size) : mem_alloc(sizeof(header) + size));
+            if (!h) {
+                return nullptr;
+            }
+            h->_pool = p;
+            return h + 1;
+        }
+
+        static void operator delete(void *ptr, size_t size) noexcept {
+            header *h = (header*)ptr - 1;
+            if (!h->_pool) {
+                mem_free(h, sizeof(header) + size);
+            }
+        }
+
+        static task get_return_object_on_allocation_failure() noexcept {
+            return task();
+        }
+
+        task get_return_object() noexcept {
+            return task();
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+
+/* readiness of one fd, lives in the coroutine frame. the io stays connected to
+ * it for its whole life, so an edge arriving while nothing awaits is kept and
+ * the next await returns at once. resumes from inside reactor::loop. */
+class co_io {
+private:
+    reactor *_reactor;
+    int _fd;
+    int _pending;
+    int _mask;
+    std::coroutine_handle<> _waiter;
+
+    static constexpr int always = reactor::poll_err | reactor::poll_hup | reactor::poll_close;
+
+    /* after resume the frame may be gone, touch nothing */
+    int on_event(reactor::io&, int flags) {
+        _pending |= flags;
+        if (_waiter && (_pending & (_mask | always))) {
+            std::coroutine_handle<> h = _waiter;
+            _waiter = nullptr;
+            h.resume();
+        }
+        return ok;
+    }
+
+public:
+    class awaiter {
+    private:
+        co_io *_io;
+        int _mask;
+    public:
+        awaiter(co_io *io, int mask) noexcept : _io(io), _mask(mask) {}
+
+        bool await_ready() noexcept {
+            return _io->_pending & (_mask | always);
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept {
+            _io->_mask = _mask;
+            _io->_waiter = h;
+        }
+
+        /* the flags seen, the awaited ones are consumed */
+        int await_resume() noexcept {
+            int flags = _io->_pending;
+            _io->_pending &= ~_mask;
+            return flags;
+        }
+    };
+
+    co_io() noexcept : _reactor(), _fd(-1), _pending(), _mask(), _waiter() {}
+    co_io(const co_io&) = delete;
+    co_io &operator=(const co_io&) = delete;
+
+    ~co_io() noexcept {
+        close();
+    }
+
+    int open(reactor *r, int fd, unsigned flags = reactor::poll_in | reactor::poll_out | reactor::poll_err) {
+        ll_failed_return(r->open(fd, flags, &co_io::on_event, this));
+        _reactor = r;
+        _fd = fd;
+        _pending = 0;
+        return ok;
+    }
+
+    /* stops watching the fd, a pending await is not resumed. the fd stays
+     * open, it belongs to whoever passed it to open() */
+    void close() noexcept {
+        if (_reactor) {
+            _waiter = nullptr;
+            _reactor->get(_fd)->disconnect();
+            _reactor->close(_fd);
+            _reactor = nullptr;
+        }
+    }
+
+    int get_fd() noexcept {
+        return _fd;
+    }
+
+    /* edge triggered, read or write until EAGAIN before awaiting again */
+    awaiter readable() noexcept {
+        return awaiter(this, reactor::poll_in);
+    }
+
+    awaiter writable() noexcept {
+        return awaiter(this, reactor::poll_out);
+    }
+};
+
+/* a connection driven by a coroutine, lives in the coroutine frame and takes
+ * over the connection's signal. an await resumes inside the connection's
+ * emit, a coroutine owning the connection must not end right there. */
+class co_connection {
+private:
+    connection *_conn;
+    size_t _want;
+    bool _closed;
+    bool _draining;
+    std::coroutine_handle<> _waiter;
+
+    bool ready() noexcept {
+        if (_closed) {
+            return true;
+        }
+        if (_draining) {
+            return _conn->writable();
+        }
+        return _conn->input().size() >= _want;
+    }
+
+    int on_event(connection&, int ev) {
+        if (ev & connection::ev_close) {
+            _closed = true;
+        }
+        if (_waiter && ready()) {
+            std::coroutine_handle<> h = _waiter;
+            _waiter = nullptr;
+            h.resume();
+        }
+        return ok;
+    }
+
+public:
+    class read_awaiter {
+    private:
+        co_connection *_c;
+    public:
+        read_awaiter(co_connection *c, size_t n) noexcept : _c(c) {
+            _c->_want = n;
+            _c->_draining = false;
+        }
+
+        bool await_ready() noexcept {
+            return _c->ready();
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept {
+            _c->_waiter = h;
+        }
+
+        /* bytes buffered in input(), or e_closed when fewer than asked remain */
+        int await_resume() noexcept {
+            size_t size = _c->_conn->input().size();
+            if (_c->_closed && size < _c->_want) {
+                return e_closed;
+            }
+            return (int)size;
+        }
+    };
+
+    class drain_awaiter {
+    private:
+        co_connection *_c;
+    public:
+        drain_awaiter(co_connection *c) noexcept : _c(c) {
+            _c->_draining = true;
+        }
+
+        bool await_ready() noexcept {
+            return _c->ready();
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept {
+            _c->_waiter = h;
+        }
+
+        int await_resume() noexcept {
+            _c->_draining = false;
+            return _c->_closed ? e_closed : ok;
+        }
+    };
+
+    co_connection(connection *conn) noexcept :
+        _conn(conn), _want(), _closed(!conn->opened()), _draining(), _waiter()
+    {
+        _conn->connect(&co_connection::on_event, this);
+    }
+
+    co_connection(const co_connection&) = delete;
+    co_connection &operator=(const co_connection&) = delete;
+
+    ~co_connection() noexcept {
+        _conn->disconnect();
+    }
+
+    connection *get_connection() noexcept {
+        return _conn;
+    }
+
+    /* until input() holds n bytes, the data stays in the stream */
+    read_awaiter read(size_t n) noexcept {
+        return read_awaiter(this, n);
+    }
+
+    /* until the output is below the low watermark again */
+    drain_awaiter drain() noexcept {
+        return drain_awaiter(this);
+    }
+};
+
+inline co_connection::read_awaiter stream_read(co_connection &c, size_t n) noexcept {
+    return c.read(n);
+}
+
+/* resumes from timer_manager::loop once tv has passed, the timer is one mem_alloc */
+class sleep_awaiter {
+private:
+    timer_manager *_timermgr;
+    timeval _tv;
+    std::coroutine_handle<> _waiter;
+
+    timeval on_timer(timer&, timeval) {
+        _waiter.resume();
+        return 0;
+    }
+
+public:
+    sleep_awaiter(timer_manager *timermgr, timeval tv) noexcept : _timermgr(timermgr), _tv(tv), _waiter() {}
+
+    bool await_ready() noexcept {
+        return _tv <= 0;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) noexcept {
+        _waiter = h;
+        _timermgr->schedule_r(_tv, &sleep_awaiter::on_timer, this);
+    }
+
+    void await_resume() noexcept {}
+};
+
+inline sleep_awaiter sleep(timer_manager &timermgr, timeval tv) noexcept {
+    return sleep_awaiter(&timermgr, tv);
+}
+
+/* one connect attempt. the connector is told to stop at the first failure,
+ * retrying is a loop around the await. resumes from an idle timer, which the
+ * timer_manager frees once it has run, outside the connector's own callback,
+ * so the coroutine may reuse the connector. */
+class connect_awaiter {
+private:
+    connector *_connector;
+    int _result;
+    bool _scheduled;
+    std::coroutine_handle<> _waiter;
+
+    void resume() {
+        _waiter.resume();
+    }
+
+    int on_event(connector&, int fd, int type) {
+        if (type & reactor::poll_out) {
+            _result = fd;
+        }
+        else if (type & reactor::poll_err) {
+            _result = fail;
+        }
+        else {
+            return ok;
+        }
+        _scheduled = true;
+        _connector->get_timer_manager()->idle(&connect_awaiter::resume, this);
+        return _result == fail ? fail : ok;
+    }
+
+public:
+    connect_awaiter(connector *c) noexcept : _connector(c), _result(fail), _scheduled(), _waiter() {}
+
+    bool await_ready() noexcept {
+        return false;
+    }
+
+    /* false resumes at once, the connect failed before any event */
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+        _waiter = h;
+        return ll_ok(_connector->connect(&connect_awaiter::on_event, this)) || _scheduled;
+    }
+
+    /* the connected fd, or fail */
+    int await_resume() noexcept {
+        return _result;
+    }
+};
+
+inline connect_awaiter connect(connector &c) noexcept {
+    return connect_awaiter(&c);
+}
+
+}
+
+#endif
+#endif
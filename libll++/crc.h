@@ -2,6 +2,7 @@
 #define __LIBLLPP_CRC_H__
 
 #include <cstdint>
+#include <cstddef>
 
 namespace ll {
 
@@ -67,26 +68,133 @@ public:
     }
 };
 
+namespace crc_helper { // begin namespace crc_helper
+    typedef uint32_t (*update_fn)(const void *buf, size_t len, uint32_t crc);
+
+    /* everything derived from one reflected 32 bit polynomial, bit 31 is x^0.
+     * filled in by the crc module, slice 0 is a copy of the constant table. */
+    struct tables {
+        uint32_t _poly;
+        uint32_t _slice[8][256];
+        uint32_t _x2n[64];          /* x^(2^n) mod p */
+        uint64_t _fold[8];          /* k1 k2 k3 k4 k5 0 p mu, for pclmul folding */
+
+        void init(uint32_t poly, const uint32_t *slice0);
+
+        /* a * b mod p */
+        uint32_t multmodp(uint32_t a, uint32_t b) const;
+
+        /* the register after len more zero bytes */
+        uint32_t shift(uint32_t crc, size_t len) const;
+
+        /* slicing by 8, 8 bytes per step */
+        uint32_t slice8(const void *buf, size_t len, uint32_t crc) const;
+    };
+} // end namespace crc_helper
+
+/* the 32 bit crcs work on the raw register: no initial value or final xor is
+ * applied, the usual crc32 of s is ~crc32::make(s, len, ~0U).
+ * make() is dispatched once at startup to the fastest path the cpu supports. */
 class crc32 {
+    friend class crc_module;
 public:
     typedef uint32_t crc_t;
     static constexpr unsigned poly = 0xedb88320U;
 private:
     static const crc_t _tab[256];
+    static crc_helper::tables _tables;
+    static crc_helper::update_fn _update;
+    static const char *_backend;
 
 public:
+    /* the constant table, usable before the module is initialized */
     static crc_t make(register crc_t crc, register uint8_t c) {
         return (crc >> 8) ^ _tab[(crc ^ c) & 0xff];
     }
 
-    static crc_t make(const void *buf, register unsigned len, register crc_t crc = 0) {
-        register uint8_t *p = (uint8_t*)buf;
-        while (len--) {
-            crc = make(crc, *p++);
-        }
+    static crc_t make(const void *buf, size_t len, crc_t crc = 0) {
+        return _update(buf, len, crc);
+    }
+
+    /* the portable table path */
+    static crc_t make_table(const void *buf, size_t len, crc_t crc = 0) {
+        return _tables.slice8(buf, len, crc);
+    }
+
+    /* crc of a followed by b, from crc(a), crc(b) started at 0, and the length of b.
+     * lets chunks be summed in parallel. */
+    static crc_t combine(crc_t crc1, crc_t crc2, size_t len2) {
+        return _tables.shift(crc1, len2) ^ crc2;
+    }
+
+    /* any container with foreach_chunk(), e.g. stream */
+    template <typename _Stream>
+    static crc_t make_chunks(const _Stream &s, crc_t crc = 0) {
+        s.foreach_chunk([&crc](const char *firstp, const char *endp) {
+            crc = make(firstp, endp - firstp, crc);
+            return true;
+        });
         return crc;
     }
 
+    static const char *backend() {
+        return _backend;
+    }
+
+    template <typename _T>
+    static crc_t make(_T &obj, crc_t crc = 0) {
+        return make(&obj, sizeof(_T), crc);
+    }
+
+    template <typename _T>
+    static crc_t make(_T *obj, crc_t crc = 0) {
+        return make(obj, sizeof(_T), crc);
+    }
+};
+
+/* castagnoli, the sse4.2 crc32 instruction computes this one */
+class crc32c {
+    friend class crc_module;
+public:
+    typedef uint32_t crc_t;
+    static constexpr unsigned poly = 0x82f63b78U;
+private:
+    static const crc_t _tab[256];
+    static crc_helper::tables _tables;
+    static crc_helper::update_fn _update;
+    static const char *_backend;
+
+public:
+    /* the constant table, usable before the module is initialized */
+    static crc_t make(register crc_t crc, register uint8_t c) {
+        return (crc >> 8) ^ _tab[(crc ^ c) & 0xff];
+    }
+
+    static crc_t make(const void *buf, size_t len, crc_t crc = 0) {
+        return _update(buf, len, crc);
+    }
+
+    static crc_t make_table(const void *buf, size_t len, crc_t crc = 0) {
+        return _tables.slice8(buf, len, crc);
+    }
+
+    static crc_t combine(crc_t crc1, crc_t crc2, size_t len2) {
+        return _tables.shift(crc1, len2) ^ crc2;
+    }
+
+    template <typename _Stream>
+    static crc_t make_chunks(const _Stream &s, crc_t crc = 0) {
+        s.foreach_chunk([&crc](const char *firstp, const char *endp) {
+            crc = make(firstp, endp - firstp, crc);
+            return true;
+        });
+        return crc;
+    }
+
+    static const char *backend() {
+        return _backend;
+    }
+
     template <typename _T>
     static crc_t make(_T &obj, crc_t crc = 0) {
         return make(&obj, sizeof(_T), crc);
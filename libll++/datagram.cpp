@@ -0,0 +1,366 @@
+#include <cstring>
+#include <unistd.h>
+
+#include "datagram.h"
+#include "guard.h"
+
+namespace ll {
+
+static constexpr unsigned datagram_poll_flags = reactor::poll_in | reactor::poll_err;
+
+datagram::datagram(reactor *reactor, timer_manager *timermgr, page_allocator *pa) noexcept :
+    signal<int(datagram&, datagram_packet*, unsigned), true>(),
+    _reactor(reactor),
+    _timermgr(timermgr),
+    _pa(pa ? pa : page_allocator::global()),
+    _fd(-1),
+    _packet_size(default_packet_size),
+    _batch(),
+    _gro(false),
+    _poll_out(false),
+    _flush_timer(),
+    _rpage(),
+    _spage(),
+    _scount(),
+    _sused(),
+    _drops(),
+    _errors(),
+    _truncated()
+{
+}
+
+datagram::~datagram() noexcept
+{
+    close();
+}
+
+inline void datagram::close_flush_timer()
+{
+    if (_flush_timer) {
+        _timermgr->remove(_flush_timer);
+        _flush_timer = nullptr;
+    }
+}
+
+int datagram::set_poll_out(bool on)
+{
+    if (_poll_out == on) {
+        return ok;
+    }
+
+    ll_failed_return(_reactor->modify(_fd, on ? (datagram_poll_flags | reactor::poll_out) : datagram_poll_flags));
+    _poll_out = on;
+    return ok;
+}
+
+int datagram::set_packet_size(unsigned size)
+{
+    if (opened()) {
+        return e_busy;
+    }
+    if (!size || size > buffer_size) {
+        return e_inval;
+    }
+    _packet_size = size;
+    return ok;
+}
+
+int datagram::set_gro(bool on)
+{
+    if (opened()) {
+        return e_busy;
+    }
+#ifdef UDP_GRO
+    _gro = on;
+    if (on && _packet_size < gro_packet_size) {
+        _packet_size = gro_packet_size;
+    }
+    return ok;
+#else
+    return on ? e_notsupport : ok;
+#endif
+}
+
+int datagram::bind(address &addr)
+{
+    if (opened()) {
+        return e_busy;
+    }
+
+    int fd;
+    ll_sys_failed_return(fd = ::socket(addr.family(), SOCK_DGRAM, 0));
+    auto guard = make_guard([fd](){ ::close(fd); });
+
+    int n = 1;
+    ll_sys_failed_return(::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &n, sizeof(int)));
+    ll_sys_failed_return(::bind(fd, addr, addr.length()));
+    ll_failed_return(open(fd));
+    guard.dismiss();
+    return ok;
+}
+
+int datagram::open(int fd)
+{
+    if (opened()) {
+        return e_busy;
+    }
+
+#ifdef UDP_GRO
+    if (_gro) {
+        int n = 1;
+        ll_sys_failed_return(::setsockopt(fd, SOL_UDP, UDP_GRO, &n, sizeof(int)));
+    }
+#endif
+
+    _batch = buffer_size / _packet_size;
+    if (_batch > max_batch) {
+        _batch = max_batch;
+    }
+
+    if (!_rpage) {
+        _rpage = _pa->alloc(buffer_size);
+    }
+    if (!_spage) {
+        _spage = _pa->alloc(buffer_size);
+    }
+
+    ll_failed_return(_reactor->open(fd, datagram_poll_flags, &datagram::io_handler, this));
+    _fd = fd;
+    _poll_out = false;
+    _scount = 0;
+    _sused = 0;
+    return ok;
+}
+
+void datagram::close()
+{
+    close_flush_timer();
+    if (opened()) {
+        _reactor->close(_fd);
+    }
+    if (_rpage) {
+        _pa->free(_rpage);
+        _rpage = nullptr;
+    }
+    if (_spage) {
+        _pa->free(_spage);
+        _spage = nullptr;
+    }
+}
+
+int datagram::io_handler(file_io &io, int type)
+{
+    if (type & reactor::poll_close) {
+        close_flush_timer();
+        io.close();
+        _fd = -1;
+        _scount = 0;
+        _sused = 0;
+        return ok;
+    }
+
+    if (type & reactor::poll_out) {
+        close_flush_timer();
+        ll_failed_return(flush());
+    }
+
+    /* a pending socket error (ICMP) is reported through recvmmsg */
+    if (type & (reactor::poll_in | reactor::poll_err)) {
+        ll_failed_return(receive());
+    }
+    return ok;
+}
+
+int datagram::receive()
+{
+    while (opened()) {
+        for (unsigned i = 0; i < _batch; i++) {
+            struct msghdr &hdr = _rmsgs[i].msg_hdr;
+            _riovs[i].iov_base = _rpage->firstp + i * _packet_size;
+            _riovs[i].iov_len = _packet_size;
+            hdr.msg_name = (struct sockaddr*)_rpackets[i]._addr;
+            hdr.msg_namelen = address::max_length();
+            hdr.msg_iov = &_riovs[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = _gro ? _rcontrols[i] : nullptr;
+            hdr.msg_controllen = _gro ? control_size : 0;
+            hdr.msg_flags = 0;
+        }
+
+        int n = ::recvmmsg(_fd, _rmsgs, _batch, MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            switch (errno) {
+            case EAGAIN:
+                return ok;
+            case EINTR:
+                continue;
+            case ECONNREFUSED:
+            case EHOSTUNREACH:
+            case ENETUNREACH:
+                /* an earlier send bounced, the socket stays usable */
+                _errors++;
+                continue;
+            default:
+                return ll_sys_rc(errno);
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            struct msghdr &hdr = _rmsgs[i].msg_hdr;
+            packet &pkt = _rpackets[i];
+            pkt._addr.set_length(hdr.msg_namelen);
+            pkt._data = (char*)_riovs[i].iov_base;
+            pkt._size = _rmsgs[i].msg_len;
+            pkt._segment = 0;
+            if (hdr.msg_flags & MSG_TRUNC) {
+                _truncated++;
+            }
+#ifdef UDP_GRO
+            if (_gro) {
+                for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                        int segment;
+                        memcpy(&segment, CMSG_DATA(cmsg), sizeof(int));
+                        pkt._segment = segment < (int)pkt._size ? segment : 0;
+                    }
+                }
+            }
+#endif
+        }
+
+        if (n) {
+            ll_failed_return(emit(*this, _rpackets, n));
+        }
+
+        /* a short batch drained the queue, new datagrams raise a new edge */
+        if ((unsigned)n < _batch) {
+            break;
+        }
+    }
+    return ok;
+}
+
+void datagram::flush_handler()
+{
+    _flush_timer = nullptr;
+    if (ll_failed(flush())) {
+        _reactor->close(_fd);
+    }
+}
+
+int datagram::send(const void *buf, size_t size, address &to, unsigned segment)
+{
+    if (!opened()) {
+        return e_closed;
+    }
+
+    if (size > max_send_size) {
+        return e_inval;
+    }
+
+#ifndef UDP_SEGMENT
+    if (segment) {
+        return e_notsupport;
+    }
+#endif
+
+    if (_scount == max_batch || _sused + size > buffer_size) {
+        ll_failed_return(flush());
+        if (_scount == max_batch || _sused + size > buffer_size) {
+            _drops++;
+            return full;
+        }
+    }
+
+    unsigned i = _scount++;
+    char *data = _spage->firstp + _sused;
+    memcpy(data, buf, size);
+    _sused += size;
+
+    _saddrs[i] = to;
+    _siovs[i].iov_base = data;
+    _siovs[i].iov_len = size;
+
+    struct msghdr &hdr = _smsgs[i].msg_hdr;
+    hdr.msg_name = (struct sockaddr*)_saddrs[i];
+    hdr.msg_namelen = _saddrs[i].length();
+    hdr.msg_iov = &_siovs[i];
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = nullptr;
+    hdr.msg_controllen = 0;
+    hdr.msg_flags = 0;
+
+#ifdef UDP_SEGMENT
+    if (segment && segment < size) {
+        hdr.msg_control = _scontrols[i];
+        hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t n = segment;
+        memcpy(CMSG_DATA(cmsg), &n, sizeof(n));
+    }
+#endif
+
+    /* while poll_out is armed the kernel buffer is full, the reactor flushes */
+    if (!_flush_timer && !_poll_out) {
+        _flush_timer = _timermgr->idle(&datagram::flush_handler, this);
+    }
+    return ok;
+}
+
+void datagram::shift(unsigned sent)
+{
+    unsigned left = _scount - sent;
+
+    /* the payloads are packed in queue order, move the unsent tail to the front 
+       so partial sends never leave the consumed prefix behind */
+    unsigned consumed = left ? (char*)_siovs[sent].iov_base - _spage->firstp : _sused;
+    if (left && consumed) {
+        memmove(_spage->firstp, _spage->firstp + consumed, _sused - consumed);
+    }
+    _sused -= consumed;
+
+    for (unsigned i = 0; i < left; i++) {
+        unsigned j = i + sent;
+        _saddrs[i] = _saddrs[j];
+        _siovs[i] = _siovs[j];
+        _siovs[i].iov_base = (char*)_siovs[i].iov_base - consumed;
+        _smsgs[i] = _smsgs[j];
+        _smsgs[i].msg_hdr.msg_name = (struct sockaddr*)_saddrs[i];
+        _smsgs[i].msg_hdr.msg_iov = &_siovs[i];
+        if (_smsgs[i].msg_hdr.msg_control) {
+            memcpy(_scontrols[i], _scontrols[j], control_size);
+            _smsgs[i].msg_hdr.msg_control = _scontrols[i];
+        }
+    }
+    _scount = left;
+}
+
+int datagram::flush()
+{
+    unsigned sent = 0;
+    while (sent < _scount) {
+        int n = ::sendmmsg(_fd, _smsgs + sent, _scount - sent, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;
+            }
+            /* the first datagram was rejected, drop it and go on */
+            _errors++;
+            n = 1;
+        }
+        sent += n;
+    }
+
+    if (sent) {
+        shift(sent);
+    }
+    return set_poll_out(_scount != 0);
+}
+
+}
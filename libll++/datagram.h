@@ -0,0 +1,146 @@
+#ifndef __LIBLLPP_DATAGRAM_H__
+#define __LIBLLPP_DATAGRAM_H__
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/udp.h>
+
+#include "page.h"
+#include "socket.h"
+
+namespace ll {
+
+struct datagram_packet {
+    address _addr;
+    char *_data;
+    unsigned _size;
+    unsigned _segment;      /* GRO: size of each coalesced datagram, 0 if single */
+
+    unsigned segments() const {
+        return _segment ? (_size + _segment - 1) / _segment : 1;
+    }
+};
+
+class datagram : public signal<int(datagram&, datagram_packet*, unsigned), true> {
+public:
+    typedef datagram_packet packet;
+
+    static constexpr unsigned max_batch                 = 64;
+    static constexpr unsigned default_packet_size       = 2048;
+    static constexpr unsigned gro_packet_size           = 65536;
+    static constexpr unsigned max_send_size             = 65535;
+    static constexpr unsigned buffer_size               = page_allocator::page_max_size >> 1;
+
+private:
+    static constexpr unsigned control_size = CMSG_SPACE(sizeof(uint16_t)) > CMSG_SPACE(sizeof(int)) ?
+                                             CMSG_SPACE(sizeof(uint16_t)) : CMSG_SPACE(sizeof(int));
+
+    reactor *_reactor;
+    timer_manager *_timermgr;
+    page_allocator *_pa;
+    int _fd;
+    unsigned _packet_size;
+    unsigned _batch;
+    bool _gro;
+    bool _poll_out;
+    timer *_flush_timer;
+
+    /* receive side, the packets are valid only while the signal is emitted */
+    page *_rpage;
+    struct mmsghdr _rmsgs[max_batch];
+    struct iovec _riovs[max_batch];
+    packet _rpackets[max_batch];
+    char _rcontrols[max_batch][control_size];
+
+    /* send side, copied into _spage and flushed by one sendmmsg per loop iteration */
+    page *_spage;
+    unsigned _scount;
+    unsigned _sused;
+    struct mmsghdr _smsgs[max_batch];
+    struct iovec _siovs[max_batch];
+    address _saddrs[max_batch];
+    char _scontrols[max_batch][control_size];
+
+    size_t _drops;
+    size_t _errors;
+    size_t _truncated;
+
+    int io_handler(file_io&, int type);
+    void flush_handler();
+    int set_poll_out(bool on);
+    void close_flush_timer();
+    int receive();
+    void shift(unsigned sent);
+public:
+    datagram(reactor *reactor, timer_manager *timermgr, page_allocator *pa = nullptr) noexcept;
+    ~datagram() noexcept;
+
+    reactor *get_reactor() {
+        return _reactor;
+    }
+
+    timer_manager *get_timer_manager() {
+        return _timermgr;
+    }
+
+    int get_fd() {
+        return _fd;
+    }
+
+    bool opened() {
+        return ll_fd_valid(_fd);
+    }
+
+    /* datagrams queued but not yet accepted by the kernel */
+    unsigned backlog() {
+        return _scount;
+    }
+
+    /* sends refused because the queue and the kernel buffer were full */
+    size_t drops() {
+        return _drops;
+    }
+
+    /* datagrams the kernel rejected, e.g. ICMP unreachable or EMSGSIZE */
+    size_t errors() {
+        return _errors;
+    }
+
+    /* datagrams larger than the packet size, delivered cut */
+    size_t truncated() {
+        return _truncated;
+    }
+
+    unsigned get_packet_size() {
+        return _packet_size;
+    }
+
+    /* both must be set before open, the batch shrinks as packets grow */
+    int set_packet_size(unsigned size);
+    int set_gro(bool on);
+
+    int bind(address &addr);
+    int open(int fd);
+    void close();
+
+    /* ok when queued, full when dropped. segment != 0 asks the kernel (UDP_SEGMENT)
+     * to split buf into segment sized datagrams */
+    int send(const void *buf, size_t size, address &to, unsigned segment = 0);
+    int flush();
+
+    template <typename _F, typename ..._Args>
+    int bind(address &addr, _F &&f, _Args&&...args) {
+        connect(std::forward<_F>(f), std::forward<_Args>(args)...);
+        return bind(addr);
+    }
+
+    template <typename _F, typename ..._Args>
+    int open(int fd, _F &&f, _Args&&...args) {
+        connect(std::forward<_F>(f), std::forward<_Args>(args)...);
+        return open(fd);
+    }
+};
+
+}
+
+#endif
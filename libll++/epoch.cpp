@@ -0,0 +1,159 @@
+#include "epoch.h"
+#include "module.h"
+
+namespace ll {
+
+epoch_domain *epoch_domain::_global = nullptr;
+thread_local epoch_domain::thread_state epoch_domain::_thread_state;
+
+/* records outlive their threads until the next reclaim unlinks them */
+epoch_domain::thread_state::~thread_state()
+{
+    record *r = _records;
+    while (r) {
+        /* once _dead is set a reclaim may free r */
+        record *next = r->_next_local;
+        r->_epoch.store(0, std::memory_order_release);
+        r->_dead.store(true, std::memory_order_release);
+        r = next;
+    }
+}
+
+epoch_domain::epoch_domain() noexcept : _epoch(1), _pending(0), _records(), _retired()
+{
+}
+
+epoch_domain::~epoch_domain() noexcept
+{
+    retired *r;
+    while ((r = _retired.pop_front())) {
+        r->_fn(r->_ptr);
+        delete r;
+    }
+
+    record *rec;
+    while ((rec = _records.pop_front())) {
+        /* a live thread keeps the pointer in its chain, never free those */
+        if (rec->_dead.load(std::memory_order_acquire)) {
+            delete rec;
+        }
+    }
+}
+
+epoch_domain::record *epoch_domain::get_record()
+{
+    for (record *r = _thread_state._records; r; r = r->_next_local) {
+        if (r->_domain == this) {
+            return r;
+        }
+    }
+
+    record *r = new record();
+    r->_domain = this;
+    r->_epoch.store(0, std::memory_order_relaxed);
+    r->_dead.store(false, std::memory_order_relaxed);
+    r->_next_local = _thread_state._records;
+    _thread_state._records = r;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _records.push_front(r);
+    return r;
+}
+
+void epoch_domain::online()
+{
+    record *r = get_record();
+    r->_epoch.store(_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    /* the announcement must be visible before any read of shared pointers */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void epoch_domain::offline()
+{
+    get_record()->_epoch.store(0, std::memory_order_release);
+}
+
+void epoch_domain::quiescent()
+{
+    record *r = get_record();
+    r->_epoch.store(_epoch.load(std::memory_order_acquire), std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (_pending.load(std::memory_order_relaxed)) {
+        reclaim();
+    }
+}
+
+void epoch_domain::retire(void *p, reclaim_fn fn)
+{
+    retired *r = new retired();
+    r->_ptr = p;
+    r->_fn = fn;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    /* readers announcing a later epoch started after p was unlinked */
+    r->_epoch = _epoch.fetch_add(1, std::memory_order_acq_rel);
+    _retired.push_back(r);
+    _pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t epoch_domain::reclaim()
+{
+    ll_list(retired, _entry) ready;
+    {
+        std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return 0;
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t min = _epoch.load(std::memory_order_acquire);
+        record *prev = nullptr;
+        record *rec = _records.front();
+        while (rec) {
+            record *next = ll_list(record, _entry)::next(rec);
+            if (rec->_dead.load(std::memory_order_acquire)) {
+                _records.remove(rec, prev);
+                delete rec;
+            }
+            else {
+                uint64_t e = rec->_epoch.load(std::memory_order_acquire);
+                if (e && e < min) {
+                    min = e;
+                }
+                prev = rec;
+            }
+            rec = next;
+        }
+
+        retired *r;
+        while ((r = _retired.front()) && r->_epoch < min) {
+            _retired.pop_front();
+            ready.push_back(r);
+        }
+    }
+
+    /* run the reclaimers outside the lock, they may retire again */
+    size_t n = 0;
+    retired *r;
+    while ((r = ready.pop_front())) {
+        r->_fn(r->_ptr);
+        delete r;
+        n++;
+    }
+    _pending.fetch_sub(n, std::memory_order_relaxed);
+    return n;
+}
+
+class epoch_module {
+public:
+    int module_init() {
+        static epoch_domain tmp;
+        epoch_domain::_global = &tmp;
+        return 0;
+    }
+};
+
+ll_module(epoch_module);
+
+}
@@ -0,0 +1,86 @@
+#ifndef __LIBLLPP_EPOCH_H__
+#define __LIBLLPP_EPOCH_H__
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+#include "list.h"
+
+namespace ll {
+
+/* quiescent state based reclamation.
+ * a reader thread holds references to shared objects only between two of its
+ * quiescent states, and holds none while offline. a writer unlinks an object
+ * and retires it, it is freed once every online thread has passed a quiescent
+ * state after the retire. */
+class epoch_domain {
+    friend class epoch_module;
+public:
+    typedef void (*reclaim_fn)(void*);
+
+private:
+    struct record {
+        slist_entry _entry;
+        record *_next_local;
+        epoch_domain *_domain;
+        std::atomic<uint64_t> _epoch;       /* 0 while offline */
+        std::atomic<bool> _dead;            /* the owning thread has exited */
+    };
+
+    struct retired {
+        stlist_entry _entry;
+        void *_ptr;
+        reclaim_fn _fn;
+        uint64_t _epoch;
+    };
+
+    struct thread_state {
+        record *_records;
+        thread_state() : _records() {}
+        ~thread_state();
+    };
+
+    std::mutex _mutex;
+    std::atomic<uint64_t> _epoch;
+    std::atomic<size_t> _pending;
+    ll_list(record, _entry) _records;
+    ll_list(retired, _entry) _retired;
+
+    static thread_local thread_state _thread_state;
+    static epoch_domain *_global;
+
+    record *get_record();
+public:
+    epoch_domain() noexcept;
+    ~epoch_domain() noexcept;
+
+    /* the calling thread starts reading, registers it on first use */
+    void online();
+
+    /* the calling thread holds no references until the next online(),
+     * e.g. while blocked in epoll_wait. its record stops holding back
+     * reclaim(), as it does once the thread exits */
+    void offline();
+
+    /* the calling thread holds no references obtained before this call */
+    void quiescent();
+
+    /* p is already unlinked, fn(p) runs once no reader can see it */
+    void retire(void *p, reclaim_fn fn);
+
+    /* frees what every online thread has passed, returns the number freed */
+    size_t reclaim();
+
+    size_t pending() {
+        return _pending.load(std::memory_order_relaxed);
+    }
+
+    static epoch_domain *global() {
+        return _global;
+    }
+};
+
+}
+
+#endif
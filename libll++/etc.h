@@ -13,6 +13,7 @@
 #define ll_align_order          3
 #define ll_align_size           (1 << ll_align_order)
 #define ll_align_default(x)     ll_align(x, ll_align_size)
+#define ll_cacheline_size       64
 
 #define ll_likely(x)            __builtin_expect(!!(x), 1)
 #define ll_unlikely(x)          __builtin_expect(!!(x), 0)
@@ -0,0 +1,396 @@
+#include <cstdlib>
+#include <climits>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "executor.h"
+#include "reactor.h"
+
+namespace ll {
+
+namespace executor_helper { // begin namespace executor_helper
+
+/* per thread free lists of job blocks, one per 16 byte size class */
+class job_cache {
+private:
+    static constexpr size_t granule = 16;
+    static constexpr size_t classes = 32;
+    static constexpr unsigned max_free = 256;
+
+    struct node {
+        node *_next;
+    };
+
+    node *_free[classes];
+    unsigned _count[classes];
+public:
+    job_cache() noexcept {
+        for (size_t i = 0; i < classes; i++) {
+            _free[i] = nullptr;
+            _count[i] = 0;
+        }
+    }
+
+    ~job_cache() noexcept {
+        for (size_t i = 0; i < classes; i++) {
+            node *n;
+            while ((n = _free[i])) {
+                _free[i] = n->_next;
+                std::free(n);
+            }
+        }
+    }
+
+    void *alloc(size_t size) noexcept {
+        size_t i = (size - 1) / granule;
+        if (i >= classes) {
+            return std::malloc(size);
+        }
+        node *n = _free[i];
+        if (n) {
+            _free[i] = n->_next;
+            _count[i]--;
+            return n;
+        }
+        return std::malloc((i + 1) * granule);
+    }
+
+    /* a thread that only frees keeps max_free per class, the rest goes back to malloc */
+    void free(void *p, size_t size) noexcept {
+        size_t i = (size - 1) / granule;
+        if (i >= classes || _count[i] >= max_free) {
+            std::free(p);
+            return;
+        }
+        node *n = (node*)p;
+        n->_next = _free[i];
+        _free[i] = n;
+        _count[i]++;
+    }
+};
+
+static thread_local job_cache _job_cache;
+
+void *job::alloc(size_t size) noexcept
+{
+    return _job_cache.alloc(size);
+}
+
+void job::free(void *p, size_t size) noexcept
+{
+    _job_cache.free(p, size);
+}
+
+/* deque */
+deque::array *deque::new_array(int64_t capacity, array *prev) noexcept
+{
+    array *a = (array*)std::malloc(sizeof(array) + sizeof(std::atomic<job*>) * (capacity - 1));
+    a->_prev = prev;
+    a->_mask = capacity - 1;
+    for (int64_t i = 0; i < capacity; i++) {
+        new (a->_slots + i) std::atomic<job*>(nullptr);
+    }
+    return a;
+}
+
+deque::deque() noexcept : _top(0), _bottom(0), _array(new_array(initial_capacity, nullptr))
+{
+}
+
+deque::~deque() noexcept
+{
+    array *a = _array.load(std::memory_order_relaxed);
+    while (a) {
+        array *prev = a->_prev;
+        std::free(a);
+        a = prev;
+    }
+}
+
+deque::array *deque::grow(array *a, int64_t bottom, int64_t top) noexcept
+{
+    array *na = new_array((a->_mask + 1) << 1, a);
+    for (int64_t i = top; i < bottom; i++) {
+        na->put(i, a->get(i));
+    }
+    _array.store(na, std::memory_order_release);
+    return na;
+}
+
+void deque::push(job *j) noexcept
+{
+    int64_t b = _bottom.load(std::memory_order_relaxed);
+    int64_t t = _top.load(std::memory_order_acquire);
+    array *a = _array.load(std::memory_order_relaxed);
+    if (ll_unlikely(b - t > a->_mask)) {
+        a = grow(a, b, t);
+    }
+    a->put(b, j);
+    _bottom.store(b + 1, std::memory_order_release);
+}
+
+job *deque::take() noexcept
+{
+    int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+    array *a = _array.load(std::memory_order_relaxed);
+    _bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = _top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    job *j = a->get(b);
+    if (t == b) {
+        /* the last one, race the thieves for it */
+        if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            j = nullptr;
+        }
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return j;
+}
+
+job *deque::steal() noexcept
+{
+    int64_t t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = _bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+        return nullptr;
+    }
+
+    array *a = _array.load(std::memory_order_acquire);
+    job *j = a->get(t);
+    if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return j;
+}
+
+} // end namespace executor_helper
+
+/* completion_queue */
+completion_queue::~completion_queue() noexcept
+{
+    close();
+    dispatch();
+}
+
+int completion_queue::open(reactor *r)
+{
+    if (ll_fd_valid(_fd)) {
+        return e_busy;
+    }
+
+    ll_sys_failed_return(_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    if (ll_failed(r->open(_fd, reactor::poll_in, &completion_queue::io_handler, this))) {
+        ::close(_fd);
+        _fd = -1;
+        return fail;
+    }
+    _reactor = r;
+    return ok;
+}
+
+void completion_queue::close()
+{
+    if (_reactor) {
+        _reactor->close(_fd);
+        ::close(_fd);
+        _reactor = nullptr;
+        _fd = -1;
+    }
+}
+
+int completion_queue::io_handler(file_io&, int type)
+{
+    if (type & reactor::poll_close) {
+        return ok;
+    }
+    dispatch();
+    return ok;
+}
+
+size_t completion_queue::dispatch() noexcept
+{
+    /* reset the counter first, a post after the take writes it again */
+    if (ll_fd_valid(_fd)) {
+        uint64_t n;
+        while (::read(_fd, &n, sizeof(n)) < 0 && errno == EINTR);
+    }
+
+    size_t n = 0;
+    job_stack::list_t jobs = _jobs.take_all();
+    while (job *j = jobs.pop_front()) {
+        j->run();
+        n++;
+    }
+    return n;
+}
+
+void completion_queue::post(job *j) noexcept
+{
+    if (_jobs.push(j) && ll_fd_valid(_fd)) {
+        uint64_t n = 1;
+        while (::write(_fd, &n, sizeof(n)) < 0 && errno == EINTR);
+    }
+}
+
+/* executor */
+thread_local executor::worker *executor::_current = nullptr;
+
+static inline int futex(std::atomic<int> *addr, int op, int val) noexcept
+{
+    return ::syscall(SYS_futex, reinterpret_cast<int*>(addr), op, val, nullptr, nullptr, 0);
+}
+
+executor::executor(unsigned threads) noexcept : _inject(), _wake_seq(0), _sleepers(0), _stopping(false)
+{
+    if (!threads) {
+        threads = std::thread::hardware_concurrency();
+        if (!threads) {
+            threads = 1;
+        }
+    }
+    _count = threads;
+
+    /* the deques are cache line aligned, plain new[] does not honor that before c++17 */
+    void *p;
+    if (::posix_memalign(&p, alignof(worker), sizeof(worker) * threads)) {
+        memory_fail();
+    }
+    _workers = (worker*)p;
+    for (unsigned i = 0; i < threads; i++) {
+        worker *w = new (_workers + i) worker();
+        w->_executor = this;
+        w->_index = i;
+        w->_seed = i * 2654435761u + 1;
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        worker *w = _workers + i;
+        w->_thread = std::thread([this, w]() { run(w); });
+    }
+}
+
+executor::~executor() noexcept
+{
+    _stopping.store(true, std::memory_order_seq_cst);
+    wake(INT_MAX);
+    for (unsigned i = 0; i < _count; i++) {
+        _workers[i]._thread.join();
+    }
+    for (unsigned i = 0; i < _count; i++) {
+        _workers[i].~worker();
+    }
+    std::free(_workers);
+}
+
+void executor::wake(int n) noexcept
+{
+    _wake_seq.fetch_add(1, std::memory_order_release);
+    futex(&_wake_seq, FUTEX_WAKE_PRIVATE, n);
+}
+
+void executor::submit(job *j) noexcept
+{
+    worker *w = _current;
+    if (w && w->_executor == this) {
+        w->_deque.push(j);
+    }
+    else {
+        _inject.push(j);
+    }
+
+    /* pairs with the fence in wait(), either the sleeper sees the job or we see it */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleepers.load(std::memory_order_relaxed)) {
+        wake(1);
+    }
+}
+
+bool executor::has_work() noexcept
+{
+    if (!_inject.empty()) {
+        return true;
+    }
+    for (unsigned i = 0; i < _count; i++) {
+        if (!_workers[i]._deque.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+executor::job *executor::find(worker *w) noexcept
+{
+    job *j = w->_deque.take();
+    if (j) {
+        return j;
+    }
+
+    /* keep the oldest injected job, the rest become stealable */
+    job_stack::list_t jobs = _inject.take_all();
+    j = jobs.pop_front();
+    if (j) {
+        while (job *next = jobs.pop_front()) {
+            w->_deque.push(next);
+        }
+        return j;
+    }
+
+    /* start at a random victim so thieves spread out */
+    w->_seed = w->_seed * 1103515245u + 12345u;
+    unsigned start = (w->_seed >> 16) % _count;
+    for (unsigned i = 0; i < _count; i++) {
+        worker *victim = _workers + (start + i) % _count;
+        if (victim != w && (j = victim->_deque.steal())) {
+            return j;
+        }
+    }
+    return nullptr;
+}
+
+void executor::wait() noexcept
+{
+    int seq = _wake_seq.load(std::memory_order_acquire);
+    _sleepers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_work() && !_stopping.load(std::memory_order_relaxed)) {
+        futex(&_wake_seq, FUTEX_WAIT_PRIVATE, seq);
+    }
+    _sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void executor::run(worker *w) noexcept
+{
+    static constexpr unsigned spins = 64;
+
+    _current = w;
+    unsigned idle = 0;
+    while (1) {
+        job *j = find(w);
+        if (j) {
+            idle = 0;
+            j->run();
+            continue;
+        }
+        if (_stopping.load(std::memory_order_acquire) && !has_work()) {
+            break;
+        }
+        if (++idle < spins) {
+            std::this_thread::yield();
+            continue;
+        }
+        idle = 0;
+        wait();
+    }
+    _current = nullptr;
+}
+
+}
@@ -0,0 +1,213 @@
+#ifndef __LIBLLPP_EXECUTOR_H__
+#define __LIBLLPP_EXECUTOR_H__
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+#include "etc.h"
+#include "rc.h"
+#include "closure.h"
+#include "ring.h"
+
+namespace ll {
+
+class reactor;
+class file_io;
+
+namespace executor_helper { // begin namespace executor_helper
+    /* a closure<void()> and its link in one block. blocks come from a cache of
+     * the allocating thread and go back to one of the freeing thread, both are
+     * backed by malloc so a job may end on any thread. */
+    struct job {
+        slist_entry _entry;
+        size_t _size;
+
+        static void *alloc(size_t size) noexcept;
+        static void free(void *p, size_t size) noexcept;
+
+        closure<void()> *get_closure() noexcept {
+            return reinterpret_cast<closure<void()>*>(this + 1);
+        }
+
+        /* the job outlives the caller's frame, so the callable and the
+         * arguments are copied in, a functor keeps lvalues by reference */
+        template <typename _F, typename ..._Args>
+        static job *_new(_F &&f, _Args&&...args) noexcept {
+            typedef typename std::decay<_F>::type fn_type;
+            typedef decltype(make_functor<void()>(std::declval<fn_type>(), 
+                                                  std::declval<typename std::decay<_Args>::type>()...)) functor_type;
+            typedef closure_impl<void(), functor_type> type;
+
+            size_t size = sizeof(job) + sizeof(type);
+            job *j = (job*)alloc(size);
+            j->_entry._next = nullptr;
+            j->_size = size;
+            construct<type>(j + 1, fn_type(std::forward<_F>(f)), 
+                            typename std::decay<_Args>::type(std::forward<_Args>(args))...);
+            return j;
+        }
+
+        /* runs the closure and frees the job */
+        void run() noexcept {
+            closure<void()> *c = get_closure();
+            c->apply();
+            closure<void()>::destruct(c);
+            free(this, _size);
+        }
+    };
+
+    /* any thread posts, the consumer takes all at once */
+    typedef mpsc_stack<job, slist_entry, &job::_entry> job_stack;
+
+    /* chase-lev work stealing deque, the owner pushes and takes at the bottom,
+     * thieves steal at the top. grows by doubling, outgrown arrays are kept
+     * until the deque dies since a thief may still read them. */
+    class deque {
+    private:
+        struct array {
+            array *_prev;
+            int64_t _mask;
+            std::atomic<job*> _slots[1];
+
+            job *get(int64_t i) noexcept {
+                return _slots[i & _mask].load(std::memory_order_relaxed);
+            }
+
+            void put(int64_t i, job *j) noexcept {
+                _slots[i & _mask].store(j, std::memory_order_relaxed);
+            }
+        };
+
+        static constexpr int64_t initial_capacity = 256;
+
+        alignas(ll_cacheline_size) std::atomic<int64_t> _top;
+        alignas(ll_cacheline_size) std::atomic<int64_t> _bottom;
+        std::atomic<array*> _array;
+
+        static array *new_array(int64_t capacity, array *prev) noexcept;
+        array *grow(array *a, int64_t bottom, int64_t top) noexcept;
+    public:
+        deque() noexcept;
+        ~deque() noexcept;
+
+        /* owner only */
+        void push(job *j) noexcept;
+        job *take() noexcept;
+
+        /* any thread, null if empty or lost a race */
+        job *steal() noexcept;
+
+        bool empty() noexcept {
+            return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+        }
+    };
+} // end namespace executor_helper
+
+/* runs closures on a reactor thread. any thread posts, the reactor is woken by
+ * an eventfd written only when the queue turns non empty. */
+class completion_queue {
+private:
+    typedef executor_helper::job job;
+    typedef executor_helper::job_stack job_stack;
+
+    reactor *_reactor;
+    int _fd;
+    job_stack _jobs;
+
+    int io_handler(file_io&, int type);
+public:
+    completion_queue() noexcept : _reactor(), _fd(-1), _jobs() {}
+    completion_queue(const completion_queue&) = delete;
+    completion_queue &operator=(const completion_queue&) = delete;
+    ~completion_queue() noexcept;
+
+    /* reactor thread */
+    int open(reactor *r);
+    void close();
+
+    /* runs what was posted so far, returns the number run */
+    size_t dispatch() noexcept;
+
+    /* any thread */
+    void post(job *j) noexcept;
+
+    template <typename _F, typename ..._Args>
+    void post(_F &&f, _Args&&...args) noexcept {
+        post(job::_new(std::forward<_F>(f), std::forward<_Args>(args)...));
+    }
+};
+
+/* a fixed set of worker threads running closure<void()> tasks. a worker keeps
+ * its own deque and steals from the others when it runs dry, other threads
+ * submit through a lock free injection stack. idle workers sleep on a futex,
+ * a submit makes a syscall only when one is sleeping. */
+class executor {
+private:
+    typedef executor_helper::job job;
+    typedef executor_helper::job_stack job_stack;
+
+    struct worker {
+        executor *_executor;
+        unsigned _index;
+        unsigned _seed;
+        executor_helper::deque _deque;
+        std::thread _thread;
+    };
+
+    worker *_workers;
+    unsigned _count;
+    job_stack _inject;
+    alignas(ll_cacheline_size) std::atomic<int> _wake_seq;
+    std::atomic<unsigned> _sleepers;
+    std::atomic<bool> _stopping;
+
+    static thread_local worker *_current;
+
+    void run(worker *w) noexcept;
+    job *find(worker *w) noexcept;
+    bool has_work() noexcept;
+    void wait() noexcept;
+    void wake(int n) noexcept;
+public:
+    /* 0 threads is one per cpu */
+    executor(unsigned threads = 0) noexcept;
+    executor(const executor&) = delete;
+    executor &operator=(const executor&) = delete;
+
+    /* runs what was submitted, then joins the workers */
+    ~executor() noexcept;
+
+    unsigned threads() noexcept {
+        return _count;
+    }
+
+    /* the executor of the calling worker thread, or null */
+    static executor *current() noexcept {
+        return _current ? _current->_executor : nullptr;
+    }
+
+    void submit(job *j) noexcept;
+
+    template <typename _F, typename ..._Args>
+    void submit(_F &&f, _Args&&...args) noexcept {
+        submit(job::_new(std::forward<_F>(f), std::forward<_Args>(args)...));
+    }
+
+    /* work runs on a worker, then done runs on the thread of q */
+    template <typename _Work, typename _Done>
+    void submit_then(completion_queue *q, _Work &&work, _Done &&done) noexcept {
+        typedef typename std::decay<_Work>::type work_type;
+        typedef typename std::decay<_Done>::type done_type;
+        work_type w(std::forward<_Work>(work));
+        done_type d(std::forward<_Done>(done));
+        submit([q, w, d]() mutable {
+            w();
+            q->post(std::move(d));
+        });
+    }
+};
+
+}
+
+#endif
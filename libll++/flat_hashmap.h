@@ -0,0 +1,409 @@
+#ifndef __LIBLLPP_FLAT_HASHMAP_H__
+#define __LIBLLPP_FLAT_HASHMAP_H__
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <tuple>
+#include <new>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "etc.h"
+#include "hash.h"
+#include "compare.h"
+#include "malloc_allocator.h"
+
+namespace ll {
+
+/* open addressing, swiss table layout: one control byte per slot, probed 16 at a time.
+ * the control byte is empty, deleted, or the low 7 bits of the hash for a full slot. */
+namespace flat_hashmap_helper { // begin namespace flat_hashmap_helper
+    typedef signed char ctrl_t;
+
+    static constexpr ctrl_t ctrl_empty      = -128;
+    static constexpr ctrl_t ctrl_deleted    = -2;
+    static constexpr ctrl_t ctrl_sentinel   = -1;
+
+    inline bool is_full(ctrl_t c) {
+        return c >= 0;
+    }
+
+    inline unsigned trailing_zeros(unsigned mask) {
+        return __builtin_ctz(mask);
+    }
+
+#ifdef __SSE2__
+    struct group {
+        static constexpr unsigned width = 16;
+        __m128i _ctrl;
+
+        explicit group(const ctrl_t *p) : _ctrl(_mm_loadu_si128((const __m128i*)p)) {}
+
+        unsigned match(ctrl_t h) const {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h), _ctrl));
+        }
+
+        unsigned match_empty() const {
+            return match(ctrl_empty);
+        }
+
+        /* empty and deleted are the only values below the sentinel */
+        unsigned match_empty_or_deleted() const {
+            return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(ctrl_sentinel), _ctrl));
+        }
+    };
+#else
+    struct group {
+        static constexpr unsigned width = 16;
+        ctrl_t _ctrl[width];
+
+        explicit group(const ctrl_t *p) {
+            memcpy(_ctrl, p, width);
+        }
+
+        unsigned match(ctrl_t h) const {
+            unsigned mask = 0;
+            for (unsigned i = 0; i < width; i++) {
+                mask |= (unsigned)(_ctrl[i] == h) << i;
+            }
+            return mask;
+        }
+
+        unsigned match_empty() const {
+            return match(ctrl_empty);
+        }
+
+        unsigned match_empty_or_deleted() const {
+            unsigned mask = 0;
+            for (unsigned i = 0; i < width; i++) {
+                mask |= (unsigned)(_ctrl[i] < ctrl_sentinel) << i;
+            }
+            return mask;
+        }
+    };
+#endif
+} // end namespace flat_hashmap_helper
+
+template <
+    typename _Key,
+    typename _T,
+    typename _Allocator = malloc_allocator,
+    typename _Hash = hash<_Key>,
+    typename _Compare = equal_compare<_Key>>
+class flat_hashmap {
+public:
+    typedef _Key                                    key_t;
+    typedef _T                                      type_t;
+    typedef std::pair<_Key, _T>                     value_type;
+    typedef _Allocator                              allocator_t;
+    typedef _Hash                                   hash_make_t;
+    typedef _Compare                                compare_t;
+    typedef flat_hashmap_helper::ctrl_t             ctrl_t;
+    typedef flat_hashmap_helper::group              group;
+
+    static constexpr ctrl_t ctrl_empty              = flat_hashmap_helper::ctrl_empty;
+    static constexpr ctrl_t ctrl_deleted            = flat_hashmap_helper::ctrl_deleted;
+    static constexpr ctrl_t ctrl_sentinel           = flat_hashmap_helper::ctrl_sentinel;
+    static constexpr unsigned width                 = group::width;
+    static constexpr size_t min_capacity            = width - 1;
+    static constexpr size_t npos                    = (size_t)-1;
+
+private:
+    allocator_t *_allocator;
+    ctrl_t *_ctrl;
+    value_type *_slots;
+    size_t _capacity;           /* 2^n - 1, used as mask */
+    size_t _count;
+    size_t _growth_left;
+
+    static size_t h1(hash_t hash) {
+        return hash >> 7;
+    }
+
+    static ctrl_t h2(hash_t hash) {
+        return hash & 0x7f;
+    }
+
+    /* max load factor 7/8 */
+    static size_t capacity_to_growth(size_t capacity) {
+        return capacity - capacity / 8;
+    }
+
+    static size_t normalize_capacity(size_t n) {
+        size_t capacity = min_capacity;
+        while (capacity_to_growth(capacity) < n) {
+            capacity = (capacity << 1) + 1;
+        }
+        return capacity;
+    }
+
+    static size_t slots_offset(size_t capacity) {
+        return ll_align(capacity + width, alignof(value_type));
+    }
+
+    static size_t alloc_size(size_t capacity) {
+        return slots_offset(capacity) + sizeof(value_type) * (capacity + 1);
+    }
+
+    /* the first width - 1 control bytes are mirrored after the sentinel, so a group
+     * load starting near the end wraps around without a branch */
+    void set_ctrl(size_t i, ctrl_t h) {
+        _ctrl[i] = h;
+        _ctrl[((i - (width - 1)) & _capacity) + (width - 1)] = h;
+    }
+
+    void init(size_t capacity) {
+        char *p = (char*)_allocator->alloc(alloc_size(capacity));
+        _ctrl = (ctrl_t*)p;
+        _slots = (value_type*)(p + slots_offset(capacity));
+        _capacity = capacity;
+        memset(_ctrl, ctrl_empty, capacity + width);
+        _ctrl[capacity] = ctrl_sentinel;
+        _growth_left = capacity_to_growth(capacity) - _count;
+    }
+
+    void destroy_slots() {
+        for (size_t i = 0; i <= _capacity; i++) {
+            if (flat_hashmap_helper::is_full(_ctrl[i])) {
+                _slots[i].~value_type();
+            }
+        }
+    }
+
+    size_t find_index(key_t key, hash_t hash) const {
+        size_t offset = h1(hash) & _capacity;
+        size_t step = 0;
+        while (1) {
+            group g(_ctrl + offset);
+            for (unsigned mask = g.match(h2(hash)); mask; mask &= mask - 1) {
+                size_t i = (offset + flat_hashmap_helper::trailing_zeros(mask)) & _capacity;
+                if (ll_likely(!compare_t::compare(key, _slots[i].first))) {
+                    return i;
+                }
+            }
+            if (ll_likely(g.match_empty())) {
+                return npos;
+            }
+            step += width;
+            offset = (offset + step) & _capacity;
+        }
+    }
+
+    size_t find_first_non_full(hash_t hash) const {
+        size_t offset = h1(hash) & _capacity;
+        size_t step = 0;
+        while (1) {
+            unsigned mask = group(_ctrl + offset).match_empty_or_deleted();
+            if (mask) {
+                return (offset + flat_hashmap_helper::trailing_zeros(mask)) & _capacity;
+            }
+            step += width;
+            offset = (offset + step) & _capacity;
+        }
+    }
+
+    void resize(size_t capacity) {
+        ctrl_t *old_ctrl = _ctrl;
+        value_type *old_slots = _slots;
+        size_t old_capacity = _capacity;
+
+        init(capacity);
+        for (size_t i = 0; i <= old_capacity; i++) {
+            if (flat_hashmap_helper::is_full(old_ctrl[i])) {
+                hash_t hash = hash_make_t::make(old_slots[i].first);
+                size_t n = find_first_non_full(hash);
+                set_ctrl(n, h2(hash));
+                new (_slots + n) value_type(std::move(old_slots[i]));
+                old_slots[i].~value_type();
+            }
+        }
+        _allocator->free(old_ctrl, alloc_size(old_capacity));
+    }
+
+    /* mostly tombstones: rebuild at the same size, otherwise double */
+    void rehash_and_grow() {
+        if (_count * 32 <= _capacity * 25) {
+            resize(_capacity);
+        }
+        else {
+            resize((_capacity << 1) + 1);
+        }
+    }
+
+    void erase_index(size_t i) {
+        _slots[i].~value_type();
+        _count--;
+
+        /* an empty byte is only safe if no probe sequence could have passed over
+         * a full group here, i.e. the run of full bytes around i is shorter than width */
+        size_t before = (i - width) & _capacity;
+        unsigned empty_after = group(_ctrl + i).match_empty();
+        unsigned empty_before = group(_ctrl + before).match_empty();
+        bool was_never_full = empty_before && empty_after &&
+            flat_hashmap_helper::trailing_zeros(empty_after) + (__builtin_clz(empty_before) - (32 - width)) < width;
+
+        set_ctrl(i, was_never_full ? ctrl_empty : ctrl_deleted);
+        if (was_never_full) {
+            _growth_left++;
+        }
+    }
+
+public:
+    class iterator {
+        friend class flat_hashmap;
+    protected:
+        const ctrl_t *_ctrl;
+        value_type *_slot;
+
+        iterator(const ctrl_t *ctrl, value_type *slot) : _ctrl(ctrl), _slot(slot) {
+            skip();
+        }
+
+        /* the sentinel is not empty or deleted, it stops the scan */
+        void skip() {
+            while (*_ctrl < ctrl_sentinel) {
+                _ctrl++;
+                _slot++;
+            }
+            if (*_ctrl == ctrl_sentinel) {
+                _slot = nullptr;
+            }
+        }
+
+    public:
+        value_type& operator*() {
+            return *_slot;
+        }
+
+        value_type* operator->() {
+            return _slot;
+        }
+
+        value_type* pointer() {
+            return _slot;
+        }
+
+        iterator& operator++() {
+            _ctrl++;
+            _slot++;
+            skip();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const iterator &other) const {
+            return _slot == other._slot;
+        }
+
+        bool operator!=(const iterator &other) const {
+            return _slot != other._slot;
+        }
+    };
+
+    flat_hashmap(allocator_t *allocator, size_t initsize = 16) : _allocator(allocator), _count(0) {
+        init(normalize_capacity(initsize));
+    }
+
+    flat_hashmap(const flat_hashmap&) = delete;
+    flat_hashmap &operator=(const flat_hashmap&) = delete;
+
+    ~flat_hashmap() {
+        destroy_slots();
+        _allocator->free(_ctrl, alloc_size(_capacity));
+    }
+
+    size_t count() const {
+        return _count;
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+    /* make room for n elements without further growth */
+    void reserve(size_t n) {
+        if (n > _count + _growth_left) {
+            resize(normalize_capacity(n));
+        }
+    }
+
+    void clear() {
+        destroy_slots();
+        memset(_ctrl, ctrl_empty, _capacity + width);
+        _ctrl[_capacity] = ctrl_sentinel;
+        _count = 0;
+        _growth_left = capacity_to_growth(_capacity);
+    }
+
+    type_t *get(key_t key) {
+        size_t i = find_index(key, hash_make_t::make(key));
+        return i == npos ? nullptr : &_slots[i].second;
+    }
+
+    template <typename ...Args>
+    type_t *probe(key_t key, int *flag, Args &&... args) {
+        hash_t hash = hash_make_t::make(key);
+        size_t i = find_index(key, hash);
+        if (i != npos) {
+            if (flag) {
+                *flag = 0;
+            }
+            return &_slots[i].second;
+        }
+
+        i = find_first_non_full(hash);
+        if (ll_unlikely(!_growth_left && _ctrl[i] != ctrl_deleted)) {
+            rehash_and_grow();
+            i = find_first_non_full(hash);
+        }
+
+        _count++;
+        _growth_left -= (_ctrl[i] == ctrl_empty);
+        set_ctrl(i, h2(hash));
+        new (_slots + i) value_type(std::piecewise_construct,
+                                    std::forward_as_tuple(key),
+                                    std::forward_as_tuple(std::forward<Args>(args)...));
+        if (flag) {
+            *flag = 1;
+        }
+        return &_slots[i].second;
+    }
+
+    bool remove(key_t key) {
+        size_t i = find_index(key, hash_make_t::make(key));
+        if (i == npos) {
+            return false;
+        }
+        erase_index(i);
+        return true;
+    }
+
+    iterator remove(iterator it) {
+        erase_index(it._slot - _slots);
+        return ++it;
+    }
+
+    iterator begin() {
+        return iterator(_ctrl, _slots);
+    }
+
+    iterator end() {
+        return iterator(_ctrl + _capacity, nullptr);
+    }
+
+    double load_factor() {
+        return (double)_count / (double)(_capacity + 1);
+    }
+};
+
+}
+
+#endif
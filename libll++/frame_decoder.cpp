@@ -0,0 +1,140 @@
+#include "frame_decoder.h"
+
+namespace ll {
+
+frame_decoder::frame_decoder(unsigned mode, size_t max_frame_size, char delim) noexcept :
+    signal<int(frame_decoder&, stream_helper::input*, unsigned), true>(),
+    _mode(mode),
+    _delim(delim),
+    _max_frame_size(max_frame_size ? max_frame_size : default_max_frame_size),
+    _scanned(),
+    _count()
+{
+    assert(mode <= mode_delimiter);
+}
+
+int frame_decoder::parse(stream_helper::input &cur, stream_helper::input &frame) noexcept
+{
+    unsigned char hdr[max_varint_size];
+    size_t hlen, len;
+
+    switch (_mode) {
+    case mode_delimiter: {
+        long n = cur.find(_delim, _scanned);
+        if (n < 0) {
+            if (cur._size > _max_frame_size) {
+                return e_inval;
+            }
+            _scanned = cur._size;
+            return notready;
+        }
+        if ((size_t)n > _max_frame_size) {
+            return e_inval;
+        }
+        _scanned = 0;
+        frame = stream_helper::input(cur, n);
+        cur.discard(n + 1);
+        return ok;
+    }
+    case mode_fixed16:
+        if (cur._size < 2) {
+            return notready;
+        }
+        cur.peek(hdr, 2);
+        hlen = 2;
+        len = ((size_t)hdr[0] << 8) | hdr[1];
+        break;
+    case mode_fixed32:
+        if (cur._size < 4) {
+            return notready;
+        }
+        cur.peek(hdr, 4);
+        hlen = 4;
+        len = ((size_t)hdr[0] << 24) | ((size_t)hdr[1] << 16) | ((size_t)hdr[2] << 8) | hdr[3];
+        break;
+    default: {
+        size_t n = cur.peek(hdr, max_varint_size);
+        len = 0;
+        hlen = 0;
+        while (1) {
+            if (hlen == n) {
+                return n == max_varint_size ? e_inval : notready;
+            }
+            unsigned char c = hdr[hlen];
+            len |= (size_t)(c & 0x7f) << (7 * hlen);
+            hlen++;
+            if (!(c & 0x80)) {
+                break;
+            }
+        }
+        break;
+    }
+    }
+
+    if (len > _max_frame_size) {
+        return e_inval;
+    }
+
+    if (cur._size < hlen + len) {
+        return notready;
+    }
+
+    cur.discard(hlen);
+    frame = stream_helper::input(cur, len);
+    if (len) {
+        cur.discard(len);
+    }
+    return ok;
+}
+
+inline int frame_decoder::dispatch() noexcept
+{
+    unsigned count = _count;
+    _count = 0;
+    return emit(*this, _batch, count);
+}
+
+int frame_decoder::decode(stream &s) noexcept
+{
+    stream_helper::input cur(s.data());
+    size_t consumed = 0;
+    int frames = 0;
+    int n;
+
+    _count = 0;
+    while (cur._size) {
+        size_t size = cur._size;
+        n = parse(cur, _batch[_count]);
+        if (n == notready) {
+            break;
+        }
+        if (ll_failed(n)) {
+            s.discard(consumed);
+            return n;
+        }
+
+        consumed += size - cur._size;
+        frames++;
+        if (++_count == max_batch) {
+            ll_failed_return_ex(dispatch(), s.discard(consumed));
+        }
+    }
+
+    if (_count) {
+        ll_failed_return_ex(dispatch(), s.discard(consumed));
+    }
+
+    s.discard(consumed);
+    return frames;
+}
+
+int frame_decoder::feed(int fd, stream &s) noexcept
+{
+    int n = s.load(fd);
+    int frames = decode(s);
+    ll_failed_return(n);
+    return frames;
+}
+
+}
+
@@ -0,0 +1,76 @@
+#ifndef __LIBLLPP_FRAME_DECODER_H__
+#define __LIBLLPP_FRAME_DECODER_H__
+
+#include "stream.h"
+#include "slotsig.h"
+
+namespace ll {
+
+class frame_decoder : public signal<int(frame_decoder&, stream_helper::input*, unsigned), true> {
+public:
+    static constexpr unsigned mode_varint           = 0;
+    static constexpr unsigned mode_fixed16          = 1;
+    static constexpr unsigned mode_fixed32          = 2;
+    static constexpr unsigned mode_delimiter        = 3;
+
+    static constexpr size_t default_max_frame_size  = 1024 * 1024;
+    static constexpr unsigned max_batch             = 64;
+    static constexpr unsigned max_varint_size       = 5;
+
+private:
+    unsigned _mode;
+    char _delim;
+    size_t _max_frame_size;
+    size_t _scanned;
+    unsigned _count;
+    stream_helper::input _batch[max_batch];
+
+    int parse(stream_helper::input &cur, stream_helper::input &frame) noexcept;
+    int dispatch() noexcept;
+public:
+    frame_decoder(unsigned mode = mode_varint, size_t max_frame_size = 0, char delim = '\n') noexcept;
+
+    unsigned get_mode() {
+        return _mode;
+    }
+
+    size_t get_max_frame_size() {
+        return _max_frame_size;
+    }
+
+    void set_max_frame_size(size_t value) {
+        _max_frame_size = value ? value : default_max_frame_size;
+    }
+
+    char get_delimiter() {
+        return _delim;
+    }
+
+    void reset() {
+        _scanned = 0;
+        _count = 0;
+    }
+
+    /* decode every complete frame in s, dispatch them in batches and discard
+     * the consumed bytes. returns the number of frames, e_inval on a frame
+     * larger than max_frame_size. */
+    int decode(stream &s) noexcept;
+
+    /* drain fd into s and decode once, so one wakeup gives one dispatch */
+    int feed(int fd, stream &s) noexcept;
+
+    int feed(file_io &io, stream &s) noexcept {
+        return feed((int)io, s);
+    }
+
+    template <typename _F, typename ..._Args>
+    frame_decoder &on_frames(_F &&f, _Args&&...args) {
+        connect(std::forward<_F>(f), std::forward<_Args>(args)...);
+        return *this;
+    }
+};
+
+}
+
+#endif
+
@@ -2,81 +2,226 @@
 #define __LIBLLPP_HASH_H__
 
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include "etc.h"
 
 namespace ll {
 
 typedef unsigned hash_t;
 
-inline hash_t hash_string(const char *p) {
+/* wyhash: 64x64->128 multiply-xor mixing, 16 bytes per step on the short path
+ * and three independent lanes of 48 bytes per step for long keys. */
+namespace hash_helper { // begin namespace hash_helper
+    static constexpr uint64_t secret0 = 0x2d358dccaa6c78a5ULL;
+    static constexpr uint64_t secret1 = 0x8bb84b93962eacc9ULL;
+    static constexpr uint64_t secret2 = 0x4b33a62ed433d4a3ULL;
+    static constexpr uint64_t secret3 = 0x4d5a2da51de1aa47ULL;
+
+    constexpr uint64_t mul_lo(uint64_t a, uint64_t b) {
+        return a * b;
+    }
 
-    const unsigned char *str = (const unsigned char *)p;
-    unsigned int r = 0;
-    unsigned char c;
+#ifdef __SIZEOF_INT128__
+    constexpr uint64_t mul_hi(uint64_t a, uint64_t b) {
+        return (uint64_t)(((unsigned __int128)a * b) >> 64);
+    }
+#else
+    /* no 128 bit type, four 32x32 products. mid is the carry into bit 64 */
+    constexpr uint64_t mul_hi_mid(uint64_t lo_lo, uint64_t lo_hi, uint64_t hi_lo) {
+        return (lo_lo >> 32) + (uint32_t)lo_hi + (uint32_t)hi_lo;
+    }
 
-    while ((c = *str++) != 0)
-        r = r * 67 + c - 113;
+    constexpr uint64_t mul_hi_sum(uint64_t lo_lo, uint64_t lo_hi, uint64_t hi_lo, uint64_t hi_hi) {
+        return hi_hi + (lo_hi >> 32) + (hi_lo >> 32) + (mul_hi_mid(lo_lo, lo_hi, hi_lo) >> 32);
+    }
+
+    constexpr uint64_t mul_hi(uint64_t a, uint64_t b) {
+        return mul_hi_sum((a & 0xffffffff) * (b & 0xffffffff), (a & 0xffffffff) * (b >> 32),
+                          (a >> 32) * (b & 0xffffffff), (a >> 32) * (b >> 32));
+    }
+#endif
+
+    constexpr uint64_t mix(uint64_t a, uint64_t b) {
+        return mul_lo(a, b) ^ mul_hi(a, b);
+    }
+
+    /* the last step, a and b already salted */
+    constexpr uint64_t finish(uint64_t a, uint64_t b, size_t len) {
+        return mix(mul_lo(a, b) ^ secret0 ^ len, mul_hi(a, b) ^ secret1);
+    }
+
+    constexpr uint64_t seed_of(uint64_t seed) {
+        return seed ^ mix(seed ^ secret0, secret1);
+    }
+
+    /* little endian reads, so the runtime and constexpr versions agree everywhere */
+    inline uint64_t r8(const uint8_t *p) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap64(v);
+#endif
+        return v;
+    }
+
+    inline uint64_t r4(const uint8_t *p) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+
+    inline uint64_t r3(const uint8_t *p, size_t k) {
+        return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+    }
+
+    /* c++11 constexpr mirror, one return statement per function */
+    constexpr uint64_t c_byte(const char *p, size_t i) {
+        return (uint64_t)(uint8_t)p[i];
+    }
+
+    constexpr uint64_t c_r4(const char *p) {
+        return c_byte(p, 0) | (c_byte(p, 1) << 8) | (c_byte(p, 2) << 16) | (c_byte(p, 3) << 24);
+    }
+
+    constexpr uint64_t c_r8(const char *p) {
+        return c_r4(p) | (c_r4(p + 4) << 32);
+    }
+
+    constexpr uint64_t c_r3(const char *p, size_t k) {
+        return (c_byte(p, 0) << 16) | (c_byte(p, k >> 1) << 8) | c_byte(p, k - 1);
+    }
+
+    constexpr uint64_t c_short(const char *p, size_t len, uint64_t seed) {
+        return len >= 4 ?
+            finish(((c_r4(p) << 32) | c_r4(p + ((len >> 3) << 2))) ^ secret1,
+                   ((c_r4(p + len - 4) << 32) | c_r4(p + len - 4 - ((len >> 3) << 2))) ^ seed, len) :
+            len ? finish(c_r3(p, len) ^ secret1, seed, len) : finish(secret1, seed, len);
+    }
 
-    return r;
+    constexpr uint64_t c_tail(const char *p, size_t i, uint64_t seed, size_t len) {
+        return i > 16 ?
+            c_tail(p + 16, i - 16, mix(c_r8(p) ^ secret1, c_r8(p + 8) ^ seed), len) :
+            finish(c_r8(p + i - 16) ^ secret1, c_r8(p + i - 8) ^ seed, len);
+    }
+
+    constexpr uint64_t c_long(const char *p, size_t i, uint64_t seed, uint64_t see1, uint64_t see2, size_t len) {
+        return i > 48 ?
+            c_long(p + 48, i - 48,
+                   mix(c_r8(p) ^ secret1, c_r8(p + 8) ^ seed),
+                   mix(c_r8(p + 16) ^ secret2, c_r8(p + 24) ^ see1),
+                   mix(c_r8(p + 32) ^ secret3, c_r8(p + 40) ^ see2), len) :
+            c_tail(p, i, seed ^ see1 ^ see2, len);
+    }
+
+    constexpr uint64_t c_hash(const char *p, size_t len, uint64_t seed) {
+        return len <= 16 ? c_short(p, len, seed) :
+               len > 48 ? c_long(p, len, seed, seed, seed, len) : c_tail(p, len, seed, len);
+    }
+} // end namespace hash_helper
+
+inline uint64_t hash64(const void *key, size_t len, uint64_t seed = 0)
+{
+    using namespace hash_helper;
+    const uint8_t *p = (const uint8_t*)key;
+    uint64_t a, b;
+
+    seed = seed_of(seed);
+    if (ll_likely(len <= 16)) {
+        if (ll_likely(len >= 4)) {
+            a = (r4(p) << 32) | r4(p + ((len >> 3) << 2));
+            b = (r4(p + len - 4) << 32) | r4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (ll_likely(len > 0)) {
+            a = r3(p, len);
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
+    }
+    else {
+        size_t i = len;
+        if (ll_unlikely(i > 48)) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(r8(p) ^ secret1, r8(p + 8) ^ seed);
+                see1 = mix(r8(p + 16) ^ secret2, r8(p + 24) ^ see1);
+                see2 = mix(r8(p + 32) ^ secret3, r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (ll_likely(i > 48));
+            seed ^= see1 ^ see2;
+        }
+        while (ll_unlikely(i > 16)) {
+            seed = mix(r8(p) ^ secret1, r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = r8(p + i - 16);
+        b = r8(p + i - 8);
+    }
+    return finish(a ^ secret1, b ^ seed, len);
 }
 
-inline hash_t hash_string_n(const char *p, size_t size)
+/* 8 byte keys without touching memory */
+constexpr uint64_t hash64_u64(uint64_t key, uint64_t seed = 0)
 {
-    const unsigned char *str = (const unsigned char *)p;
-    unsigned int r = 0;
-    unsigned char c;
+    return hash_helper::finish(key ^ hash_helper::secret1, hash_helper::seed_of(seed) ^ hash_helper::secret0, 8);
+}
 
-    while (size--) {
-        c = *str++;
-        r = r * 67 + c - 113;
-    }
+/* same value as hash64(s, N - 1, seed), computed at compile time for literals */
+template <size_t N>
+constexpr uint64_t hash64_literal(const char (&s)[N], uint64_t seed = 0)
+{
+    return hash_helper::c_hash(s, N - 1, hash_helper::seed_of(seed));
+}
 
-    return r;
+constexpr hash_t hash_fold(uint64_t h)
+{
+    return (hash_t)(h ^ (h >> 32));
 }
 
-inline hash_t hash_iterative(const void *key, unsigned int len, hash_t initval = 0x01000193U) 
+template <size_t N>
+constexpr hash_t hash_literal(const char (&s)[N], uint64_t seed = 0)
 {
-    static constexpr uint64_t m = 0xc6a4a7935bd1e995ULL;
-    static constexpr uint64_t r = 47;
-    register uint64_t h = ((uint64_t)initval) ^ (len * m);
-    register const uint64_t *data = (const uint64_t*)key;
-    register const uint64_t *end = data + (len / sizeof(uint64_t));
-
-    register uint64_t k ;
-    while (data != end) {
-            k = *data++;
-            k *= m;
-            k ^= k >> r;
-            k *= m;
-            h ^= k;
-            h *= m;
-    };
-
-    register const unsigned char *data2 = (const unsigned char*)data;
-    switch (len & (sizeof(uint64_t) - 1)) {
-    case 7: h ^= (uint64_t)(data2[6]) << 48;
-    case 6: h ^= (uint64_t)(data2[5]) << 40;
-    case 5: h ^= (uint64_t)(data2[4]) << 32;
-    case 4: h ^= (uint64_t)(data2[3]) << 24;
-    case 3: h ^= (uint64_t)(data2[2]) << 16;
-    case 2: h ^= (uint64_t)(data2[1]) << 8;
-    case 1: h ^= (uint64_t)(data2[0]);
-            h *= m;
-    }
-    h ^= h >> r;
-    h *= m;
-    h ^= h >> r;
-    return h;
+    return hash_fold(hash64_literal(s, seed));
 }
 
+inline hash_t hash_string(const char *p)
+{
+    return hash_fold(hash64(p, strlen(p)));
+}
 
-template <typename _T>
+inline hash_t hash_string_n(const char *p, size_t size)
+{
+    return hash_fold(hash64(p, size));
+}
+
+inline hash_t hash_iterative(const void *key, unsigned int len, hash_t initval = 0x01000193U) 
+{
+    return hash_fold(hash64(key, len, initval));
+}
+
+template <typename _T, bool = std::is_integral<_T>::value || std::is_enum<_T>::value>
 struct hash {
     static hash_t make(_T &obj, hash_t initval = 0x01000193U) {
         return hash_iterative(&obj, sizeof(_T), initval);
     }
 };
 
+template <typename _T>
+struct hash<_T, true> {
+    static hash_t make(_T obj, hash_t initval = 0x01000193U) {
+        return hash_fold(hash64_u64((uint64_t)obj, initval));
+    }
+};
+
 }
 
 #endif
-
@@ -6,6 +6,7 @@
 #include "memory.h"
 #include "bitorder.h"
 #include "compare.h"
+#include "construct.h"
 
 namespace ll {
 
@@ -39,11 +40,18 @@ namespace hashmap_helper { // begin namespace hashmap_helper
         typename _Compare,
         typename _GetKey>
     struct impl {
+        /* the hash and the mask are 32 bits, a 32 bit size_t holds 1 << 31 at most */
         static constexpr unsigned min_order = 3;
-        static constexpr unsigned max_order = 20;
+        static constexpr unsigned max_order = sizeof(size_t) * 8 - 1 < 32 ? sizeof(size_t) * 8 - 1 : 32;
 
-        static constexpr unsigned min_capacity = (1 << min_order);
-        static constexpr unsigned max_capacity = (1 << max_order);
+        static constexpr size_t min_capacity = ((size_t)1 << min_order);
+        static constexpr size_t max_capacity = ((size_t)1 << max_order);
+        static constexpr unsigned default_rehash_step = 16;
+
+        /* grow past one element per bucket, shrink below one per 8 buckets.
+         * both land on a load of about 1/2, so the table cannot flap. */
+        static constexpr unsigned grow_load = 1;
+        static constexpr unsigned shrink_load = 8;
 
         typedef _T                                  type_t;
         typedef _Key                                key_t;
@@ -139,8 +147,7 @@ namespace hashmap_helper { // begin namespace hashmap_helper
         struct remove_policy<_AEntry, false> {
             static type_t *remove(map *map, key_t key) {
                 unsigned hash = hash_make_t::make(key);
-                unsigned slot = hash & map->_capacity;
-                list_t *list = map->_array + slot;
+                list_t *list = map->bucket(hash);
                 type_t *prev = nullptr;
                 type_t *elm = static_cast<type_t*>(list->front());
                 while (elm) {
@@ -155,8 +162,7 @@ namespace hashmap_helper { // begin namespace hashmap_helper
             }
 
             static type_t *remove(map *map, type_t *elm) {
-                unsigned slot = get_hash_policy<>::get_hash(elm) & map->_capacity;
-                list_t *list = map->_array + slot;
+                list_t *list = map->bucket(get_hash_policy<>::get_hash(elm));
                 if ((elm = static_cast<type_t*>(list->remove(elm)))) {
                     map->_count--;
                 }
@@ -168,8 +174,7 @@ namespace hashmap_helper { // begin namespace hashmap_helper
         struct replace_policy {
             static type_t *replace(map *map, key_t key, type_t *obj) {
                 unsigned hash = hash_make_t::make(key);
-                unsigned slot = hash & map->_capacity;
-                list_t *list = map->_array + slot;
+                list_t *list = map->bucket(hash);
                 type_t *elm = static_cast<type_t*>(list->front());
 
                 while (elm) {
@@ -193,8 +198,7 @@ namespace hashmap_helper { // begin namespace hashmap_helper
         struct replace_policy<_AEntry, false> {
             static type_t *replace(map *map, key_t key, type_t *obj) {
                 unsigned hash = hash_make_t::make(key);
-                unsigned slot = hash & map->_capacity;
-                list_t *list = map->_array + slot;
+                list_t *list = map->bucket(hash);
                 type_t *elm = static_cast<type_t*>(list->front());
                 type_t *prev = nullptr;
 
@@ -217,53 +221,122 @@ namespace hashmap_helper { // begin namespace hashmap_helper
         };
 
         struct allocator_policy_base {
-            static list_t *alloc_array(allocator_t *allocator, unsigned size) {
-                size = sizeof(list_t) * (size + 1);
+            static list_t *alloc_array(allocator_t *allocator, unsigned capacity) {
+                size_t size = sizeof(list_t) * ((size_t)capacity + 1);
                 list_t *array = (list_t*)allocator->alloc(size);
                 memset(array, 0, size);
                 return array;
             }
 
-            static void free_array(allocator_t *allocator, list_t *array, unsigned size) {
-                size = sizeof(list_t) * (size + 1);
-                allocator->free(array, size);
+            static void free_array(allocator_t *allocator, list_t *array, unsigned capacity) {
+                allocator->free(array, sizeof(list_t) * ((size_t)capacity + 1));
+            }
+
+            /* mask of the smallest power of 2 table holding n buckets */
+            static unsigned capacity_of(size_t n) {
+                size_t size = min_capacity;
+                while (size < n && size < max_capacity) {
+                    size <<= 1;
+                }
+                return size - 1;
             }
         };
 
-        template <typename _AAllocator = allocator_t, bool = check_free<_AAllocator>::value>
+        /* with a freeing allocator the table grows. the old and new bucket arrays
+         * coexist while growing: every operation moves _rehash_step old buckets,
+         * and a bucket below _rehash_index has already been moved. */
+        template <typename _AAllocator = allocator_t, bool = has_free<_AAllocator>::value>
         struct allocator_policy: allocator_policy_base {
             allocator_t *_allocator;
             list_t *_array;
             unsigned _capacity;
+            list_t *_old_array;
+            unsigned _old_capacity;
+            size_t _rehash_index;
+            unsigned _rehash_step;
+
             allocator_policy(unsigned capacity, allocator_t *allocator) : 
                 _allocator(allocator), 
                 _array(allocator_policy_base::alloc_array(allocator, capacity)),
-                _capacity(capacity) {}
+                _capacity(capacity),
+                _old_array(),
+                _old_capacity(),
+                _rehash_index(),
+                _rehash_step(default_rehash_step) {}
             ~allocator_policy() {
+                if (_old_array) {
+                    allocator_policy_base::free_array(_allocator, _old_array, _old_capacity);
+                }
                 allocator_policy_base::free_array(_allocator, _array, _capacity);
             }
 
-            bool expand() {
-                unsigned new_size = (_capacity << 1) + 1;
-                if (new_size >= max_capacity) {
-                    return false;
+            list_t *bucket(unsigned hash) {
+                if (ll_unlikely(_old_array != nullptr)) {
+                    unsigned slot = hash & _old_capacity;
+                    if (slot >= _rehash_index) {
+                        return _old_array + slot;
+                    }
                 }
+                return _array + (hash & _capacity);
+            }
 
-                list_t *new_map = allocator_policy_base::alloc_array(_allocator, new_size);
-                list_t *list, *new_list;
+            bool rehashing() {
+                return _old_array != nullptr;
+            }
+
+            void rehash_buckets(size_t n) {
+                list_t *list = _old_array + _rehash_index;
                 type_t *elm;
-                list = _array;
-                for (unsigned i = 0; i <= _capacity; i++, list++) {
+                for (; n && _rehash_index <= _old_capacity; n--, _rehash_index++, list++) {
                     while ((elm = static_cast<type_t*>(list->pop_front()))) {
-                        new_list = new_map + (get_hash_policy<>::get_hash(elm) & _capacity);
-                        new_list->push_front(elm);
+                        _array[get_hash_policy<>::get_hash(elm) & _capacity].push_front(elm);
                     }
                 }
-                allocator_policy_base::free_array(_allocator, _array, _capacity);
-                _array = new_map;
-                _capacity = new_size;
+                if (_rehash_index > _old_capacity) {
+                    allocator_policy_base::free_array(_allocator, _old_array, _old_capacity);
+                    _old_array = nullptr;
+                }
+            }
+
+            void rehash_step() {
+                if (ll_unlikely(_old_array != nullptr)) {
+                    rehash_buckets(_rehash_step ? _rehash_step : (size_t)_old_capacity + 1);
+                }
+            }
+
+            void rehash_finish() {
+                if (_old_array) {
+                    rehash_buckets((size_t)_old_capacity + 1);
+                }
+            }
+
+            /* buckets moved per operation while growing, 0 rehashes at once */
+            void set_rehash_step(unsigned n) {
+                _rehash_step = n;
+            }
+
+            /* grow or shrink to capacity + 1 buckets, capacity is a mask */
+            bool resize(unsigned capacity) {
+                if (capacity == _capacity) {
+                    return false;
+                }
+
+                rehash_finish();
+                _old_array = _array;
+                _old_capacity = _capacity;
+                _rehash_index = 0;
+                _array = allocator_policy_base::alloc_array(_allocator, capacity);
+                _capacity = capacity;
+                rehash_step();
                 return true;
             }
+
+            bool expand() {
+                if ((size_t)_capacity + 1 >= max_capacity) {
+                    return false;
+                }
+                return resize((_capacity << 1) + 1);
+            }
         };
 
         template <typename _AAllocator>
@@ -273,6 +346,23 @@ namespace hashmap_helper { // begin namespace hashmap_helper
             allocator_policy(unsigned capacity, allocator_t *allocator) : 
                 _array(allocator_policy_base::alloc_array(allocator, capacity)),
                 _capacity(capacity) {}
+
+            list_t *bucket(unsigned hash) {
+                return _array + (hash & _capacity);
+            }
+
+            bool rehashing() {
+                return false;
+            }
+
+            void rehash_step() {}
+            void rehash_finish() {}
+            void set_rehash_step(unsigned) {}
+
+            bool resize(unsigned) {
+                return false;
+            }
+
             bool expand() {
                 return false;
             }
@@ -285,28 +375,24 @@ namespace hashmap_helper { // begin namespace hashmap_helper
         protected:
             using allocator_policy<>::_array;
             using allocator_policy<>::_capacity;
-            unsigned _count;
-
-            unsigned calc_initsize(unsigned initsize) {
-                if (!ll_is_p2(initsize)) {
-                    unsigned order = bitorder::order(initsize);
-                    if (order > max_order) {
-                        order = max_order;
-                    }
-                    else if (order < min_order) {
-                        order = min_order;
-                    }
-                    initsize = (1 << order);
+            using allocator_policy<>::bucket;
+            using allocator_policy<>::rehash_step;
+            using allocator_policy<>::rehash_finish;
+            using allocator_policy<>::resize;
+            size_t _count;
+            unsigned _min_capacity;
+
+            /* after an insert, move towards a load of about 1/2. remove() never
+             * resizes, so removing while iterating is safe, a table emptied
+             * that way shrinks on the next probe() or on shrink(). */
+            void adjust() {
+                size_t buckets = (size_t)_capacity + 1;
+                if (ll_unlikely(_count > buckets * grow_load)) {
+                    expand();
                 }
-                else {
-                    if (initsize < min_capacity) {
-                        initsize = min_capacity;
-                    }
-                    else if (initsize > max_capacity) {
-                        initsize = max_capacity;
-                    }
+                else if (ll_unlikely(_count < buckets / shrink_load && _capacity > _min_capacity)) {
+                    shrink();
                 }
-                return initsize - 1;
             }
         public:
             class iterator {
@@ -318,6 +404,7 @@ namespace hashmap_helper { // begin namespace hashmap_helper
 
                 iterator(type_t *ptr) : _ptr(ptr) {}
                 iterator(map *map) : _map(map), _ptr() {
+                    map->rehash_finish();
                     list_t *bound = map->_array + map->_capacity;
                     for (_list = map->_array; _list <= bound; _list++) {
                         if ((_ptr = static_cast<type_t*>(_list->front()))) {
@@ -378,14 +465,18 @@ namespace hashmap_helper { // begin namespace hashmap_helper
             };
 
         public:
-            map(unsigned initsize, allocator_t *allocator) : 
-                allocator_policy<>(calc_initsize(initsize), allocator), _count(0) {}
+            map(size_t initsize, allocator_t *allocator) : 
+                allocator_policy<>(allocator_policy_base::capacity_of(initsize), allocator), 
+                _count(0), 
+                _min_capacity(_capacity) {}
 
             ~map() {}
 
             using allocator_policy<>::expand;
+            using allocator_policy<>::rehashing;
+            using allocator_policy<>::set_rehash_step;
 
-            unsigned count() {
+            size_t count() {
                 return _count;
             }
 
@@ -393,16 +484,41 @@ namespace hashmap_helper { // begin namespace hashmap_helper
                 return _capacity;
             }
 
+            /* grows when the load is past grow_load, inserts already do this */
             void expand_if() {
-                if (_count >= _capacity) {
+                if (_count > ((size_t)_capacity + 1) * grow_load) {
                     expand();
                 }
             }
 
+            /* down to a load of about 1/2, not below the initial or reserved
+             * size. invalidates iterators */
+            void shrink() {
+                unsigned capacity = allocator_policy_base::capacity_of(_count * 2);
+                if (capacity < _min_capacity) {
+                    capacity = _min_capacity;
+                }
+                if (capacity < _capacity) {
+                    resize(capacity);
+                }
+            }
+
+            /* presize for n elements, the table will not shrink below it */
+            void reserve(size_t n) {
+                unsigned capacity = allocator_policy_base::capacity_of(n);
+                if (capacity > _min_capacity) {
+                    _min_capacity = capacity;
+                }
+                if (capacity > _capacity) {
+                    resize(capacity);
+                }
+            }
+
             void clear(elm_allocator_t *allocator) {
+                rehash_finish();
                 list_t *list = _array;
                 type_t *elm;
-                for (unsigned i = 0; i <= _capacity; i++, list++) {
+                for (size_t i = 0; i <= _capacity; i++, list++) {
                     while ((elm = static_cast<type_t*>(list->pop_front()))) {
                         _delete<type_t>(allocator, elm);
                     }
@@ -411,14 +527,15 @@ namespace hashmap_helper { // begin namespace hashmap_helper
             }
 
             void truncate() {
-                memset(_array, 0, sizeof(list_t) * (_capacity + 1));
+                rehash_finish();
+                memset(_array, 0, sizeof(list_t) * ((size_t)_capacity + 1));
                 _count = 0;
             }
 
             type_t *get(key_t key) {
+                rehash_step();
                 unsigned hash = hash_make_t::make(key);
-                unsigned slot = hash & _capacity;
-                list_t *list = _array + slot;
+                list_t *list = bucket(hash);
 
                 type_t *elm = static_cast<type_t*>(list->front());
                 while (elm) {
@@ -432,9 +549,9 @@ namespace hashmap_helper { // begin namespace hashmap_helper
 
             template <typename ...Args>
             type_t *probe(key_t key, int *flag, elm_allocator_t *allocator, Args &&... args) {
+                rehash_step();
                 unsigned hash = hash_make_t::make(key);
-                unsigned slot = hash & _capacity;
-                list_t *list = _array + slot;
+                list_t *list = bucket(hash);
 
                 type_t *elm = static_cast<type_t*>(list->front());
                 while (elm) {
@@ -453,19 +570,27 @@ namespace hashmap_helper { // begin namespace hashmap_helper
                 if (flag) {
                     *flag = 1;
                 }
+                adjust();
                 return elm;
             }
 
             type_t *remove(key_t key) {
+                rehash_step();
                 return remove_policy<>::remove(this, key);
             }
 
             type_t *remove(type_t *elm) {
+                rehash_step();
                 return remove_policy<>::remove(this, elm);
             }
 
             type_t* replace(key_t key, type_t *obj) {
-                return replace_policy<>::replace(this, key, obj);
+                rehash_step();
+                type_t *elm = replace_policy<>::replace(this, key, obj);
+                if (!elm) {
+                    adjust();
+                }
+                return elm;
             }
 
             iterator begin() {
@@ -485,14 +610,15 @@ namespace hashmap_helper { // begin namespace hashmap_helper
             }
 
             double degree_of_uniformity() {
-                unsigned n = 0;
+                rehash_finish();
+                size_t n = 0;
                 list_t *list = _array;
-                for (unsigned i = 0; i <= _capacity; i++, list++) {
+                for (size_t i = 0; i <= _capacity; i++, list++) {
                     if (!list->empty()) {
                         n++;
                     }
                 }
-                return (double)n / (double)(_capacity + 1);
+                return (double)n / ((double)_capacity + 1);
             }
         };
     };
@@ -523,11 +649,14 @@ template <
     typename _GetKey = _T>
 class hashmap: public hashmap_helper::impl<_Key, _T, _Base, _Entry, __field, _ElmAllocator, _Allocator, _Hash, _Compare, _GetKey>::map {
 public:
-    hashmap(_Allocator *allocator, unsigned initsize = 32) : 
+    hashmap(_Allocator *allocator, size_t initsize = 32) : 
         hashmap_helper::impl<_Key, _T, _Base, _Entry, __field, _ElmAllocator, _Allocator, _Hash, _Compare, _GetKey>::map(initsize, allocator) {}
 };
 
-#define ll_hashmap(k, T, entry, ...) ll::hashmap<k, T, typeof_container(&T::entry), typeof_member(&T::entry), &T::entry, ##__VA_ARGS__>
+#define ll_hashmap(k, T, entry, ...) ll::hashmap<k, T,                  \
+    typename ll::member_of<decltype(&T::entry)>::class_type,                \
+    typename ll::member_of<decltype(&T::entry)>::type,                      \
+    &T::entry, ##__VA_ARGS__>
 
 }
 
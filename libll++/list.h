@@ -548,7 +548,7 @@ public:
 public:
     list() noexcept : _first(nullptr) {}
     list(const list &x) noexcept : _first(x._first) {}
-    list(list &&x) noexcept {
+    list(list &&x) noexcept : _first(nullptr) {
         swap(x);
     }
 
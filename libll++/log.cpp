@@ -1,14 +1,142 @@
 #include <time.h>
 #include <cstdio>
+#include <cstring>
 #include "log.h"
+#include "etc.h"
 #include "memory.h"
 #include "timeval.h"
 
 namespace ll {
 
+/* the header up to the second and the zone, per thread */
+struct time_cache {
+    long long _sec;
+    int _format;
+    unsigned _prefix_len;
+    unsigned _zone_len;
+    char _prefix[24];
+    char _zone[8];
+};
+
+static thread_local time_cache __time_cache = { -1, -1, 0, 0, {}, {} };
+
+/* what snprintf put into a buffer of size bytes */
+static inline unsigned clamp_printed(int n, size_t size)
+{
+    return n < 0 ? 0 : (size_t)n < size ? n : size - 1;
+}
+
+static void time_cache_refresh(time_cache &c, long long sec, int format)
+{
+    time_t t = sec;
+    struct ::tm tm;
+    struct ::tm *converted = format & log_time_local ? ::localtime_r(&t, &tm) : ::gmtime_r(&t, &tm);
+    bool iso = format & log_time_iso8601;
+
+    /* a time the libc cannot break down, or a year iso-8601 cannot write in 
+       4 digits, still gets a header of the same shape */
+    if (!converted || (iso && (tm.tm_year + 1900 < 0 || tm.tm_year + 1900 > 9999))) {
+        c._prefix_len = clamp_printed(snprintf(c._prefix, sizeof(c._prefix), "%s",
+                                               iso ? "----------T--:--:--" : "--:--:--"), sizeof(c._prefix));
+        const char *zone = !iso ? "" : format & log_time_local ? "+--:--" : "Z";
+        c._zone_len = clamp_printed(snprintf(c._zone, sizeof(c._zone), "%s", zone), sizeof(c._zone));
+    }
+    else if (iso) {
+        c._prefix_len = clamp_printed(snprintf(c._prefix, sizeof(c._prefix), "%04d-%02d-%02dT%02d:%02d:%02d",
+                                               tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                                               tm.tm_hour, tm.tm_min, tm.tm_sec), sizeof(c._prefix));
+        if (format & log_time_local) {
+            long offset = tm.tm_gmtoff / 60;
+            char sign = offset < 0 ? '-' : '+';
+            offset = offset < 0 ? -offset : offset;
+            c._zone_len = clamp_printed(snprintf(c._zone, sizeof(c._zone), "%c%02ld:%02ld",
+                                                 sign, offset / 60, offset % 60), sizeof(c._zone));
+        }
+        else {
+            c._zone[0] = 'Z';
+            c._zone_len = 1;
+        }
+    }
+    else {
+        c._prefix_len = clamp_printed(snprintf(c._prefix, sizeof(c._prefix), "%02d:%02d:%02d",
+                                               tm.tm_hour, tm.tm_min, tm.tm_sec), sizeof(c._prefix));
+        c._zone_len = 0;
+    }
+    c._sec = sec;
+    c._format = format;
+}
+
+size_t log_header(int type, long long usec, char *buf, size_t size)
+{
+    if (!size) {
+        return 0;
+    }
+
+    /* rounded down, a time before the epoch keeps its milliseconds positive */
+    long long sec = usec / time::usecs_of_second;
+    long long rem = usec % time::usecs_of_second;
+    if (rem < 0) {
+        sec--;
+        rem += time::usecs_of_second;
+    }
+    unsigned msec = rem / (time::usecs_of_second / time::msecs_of_second);
+    int format = log::get_time_format();
+    time_cache &c = __time_cache;
+    if (ll_unlikely(sec != c._sec || format != c._format)) {
+        time_cache_refresh(c, sec, format);
+    }
+
+    char tmp[log_header_size];
+    char *p = size >= log_header_size ? buf : tmp;
+    char *start = p;
+    memcpy(p, c._prefix, c._prefix_len);
+    p += c._prefix_len;
+    p[0] = '.';
+    p[1] = '0' + msec / 100;
+    p[2] = '0' + msec / 10 % 10;
+    p[3] = '0' + msec % 10;
+    p += 4;
+    memcpy(p, c._zone, c._zone_len);
+    p += c._zone_len;
+
+    p[0] = ':';
+    switch (type) {
+    case log_type_debug:
+        p[1] = 'D';
+        break;
+    case log_type_info:
+        p[1] = 'I';
+        break;
+    case log_type_error:
+        p[1] = 'E';
+        break;
+    default:
+        p[1] = '?';
+        break;
+    }
+    p[2] = ':';
+    p[3] = ' ';
+    p[4] = '\0';
+    p += 4;
+
+    size_t n = p - start;
+    if (start == tmp) {
+        n = n < size ? n : size - 1;
+        memcpy(buf, tmp, n);
+        buf[n] = '\0';
+    }
+    return n;
+}
+
+size_t log_header(int type, char *buf, size_t size)
+{
+    return log_header(type, time::now(), buf, size);
+}
+
+/* one obstack cached per thread, the printing threads never share one */
 class default_printer : public log_printer {
 public:
-    static obstack *_cache;
+    static thread_local obstack *_cache;
 
     void *prepare(int type) {
         obstack *pool;
@@ -20,27 +148,8 @@ public:
             pool = ll::_new<obstack>();
         }
 
-        struct ::timeval tv;
-        struct ::tm tm;
-        ::gettimeofday(&tv, nullptr);
-        ::gmtime_r(&tv.tv_sec, &tm);
-
-        pool->print("%02d:%02d:%02d.%02d",
-                    tm.tm_hour, tm.tm_min, tm.tm_sec, 
-                    (int)time_prec_msec::to_precval(tv.tv_usec));
-        switch (type) {
-        case log_type_debug:
-            pool->grow(":D", 2);
-            break;
-        case log_type_info:
-            pool->grow(":I", 2);
-            break;
-        case log_type_error:
-            pool->grow(":E", 2);
-            break;
-        }
-
-        pool->grow(": ", 2);
+        char header[log_header_size];
+        pool->grow(header, log_header(type, header, sizeof(header)));
         return pool;
     }
 
@@ -71,10 +180,12 @@ public:
     }
 };
 
-obstack *default_printer::_cache = nullptr;
+thread_local obstack *default_printer::_cache = nullptr;
 static default_printer __default_printer;
 /* log */
 log_printer *log::_printer = &__default_printer;
+std::atomic<int> log::_level(log_type_debug);
+std::atomic<int> log::_time_format(log_time_utc);
 log info = log(log_type_info);
 log debug = log(log_type_debug);
 log error = log(log_type_error);
@@ -96,5 +207,30 @@ log_printer *log::get_printer()
     return log::_printer;
 }
 
+/* log_module */
+log_module *log_module::_modules = nullptr;
+
+log_module *log_module::find(const char *name)
+{
+    for (log_module *m = _modules; m; m = m->_next) {
+        if (!strcmp(m->_name, name)) {
+            return m;
+        }
+    }
+    return nullptr;
+}
+
+int log_module::set_level(const char *name, int level)
+{
+    int rc = e_notexists;
+    for (log_module *m = _modules; m; m = m->_next) {
+        if (!strcmp(m->_name, name)) {
+            m->set_level(level);
+            rc = ok;
+        }
+    }
+    return rc;
+}
+
 
 }
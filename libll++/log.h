@@ -2,6 +2,15 @@
 #define __LIBLLPP_LOG_H__
 
 #include <cstdarg>
+#include <cstddef>
+#include <atomic>
+#include <time.h>
+
+/* lines below this type compile away in the ll_log macros, -DLL_LOG_LEVEL=1
+ * drops every debug site from the binary */
+#ifndef LL_LOG_LEVEL
+#define LL_LOG_LEVEL 0
+#endif
 
 namespace ll {
 
@@ -16,19 +25,69 @@ enum {
     log_type_debug,
     log_type_info,
     log_type_error,
+    log_type_off,       /* as a level, nothing passes */
+};
+
+/* time formats of the line header, utc or local, optionally iso-8601 */
+enum {
+    log_time_utc        = 0,
+    log_time_local      = 1,
+    log_time_iso8601    = 2,
 };
 
+/* room for the longest header, "yyyy-mm-ddThh:mm:ss.mmm+hh:mm:T: " */
+static constexpr size_t log_header_size = 48;
+
+/* "hh:mm:ss.mmm:T: " into buf, returns its length. usec is since the epoch.
+ * each thread keeps the text up to the second and its zone, a line then costs
+ * a copy and the millisecond digits. */
+size_t log_header(int type, long long usec, char *buf, size_t size);
+size_t log_header(int type, char *buf, size_t size);
+
 class log {
 private:
     static log_printer *_printer;
+    static std::atomic<int> _level;
+    static std::atomic<int> _time_format;
     int _type;
     void *_context;
     bool _ready;
 
 public:
     log(int type) : _type(type), _ready(false) {}
+
+    /* the runtime threshold, lines of a lower type are skipped before the
+     * printer is asked for anything */
+    static void set_level(int level) {
+        _level.store(level, std::memory_order_relaxed);
+    }
+
+    static int get_level() {
+        return _level.load(std::memory_order_relaxed);
+    }
+
+    static bool enabled(int type) {
+        return type >= _level.load(std::memory_order_relaxed);
+    }
+
+    /* log_time_*, applies to the next line of every thread */
+    static void set_time_format(int format) {
+        _time_format.store(format, std::memory_order_relaxed);
+    }
+
+    static int get_time_format() {
+        return _time_format.load(std::memory_order_relaxed);
+    }
+
+    bool enabled() {
+        return enabled(_type);
+    }
+
     void vprint(const char *fmt, va_list ap) {
         if (!_ready) {
+            if (!enabled()) {
+                return;
+            }
             _context = _printer->prepare(_type);
             _ready = true;
         }
@@ -39,6 +98,7 @@ public:
         va_list ap;
         va_start(ap, fmt);
         vprint(fmt, ap);
+        va_end(ap);
     }
 
     void flush() {
@@ -48,23 +108,45 @@ public:
         }
     };
 
+    /* a whole line keeps its context on the stack, so threads may share a log
+     * object as long as they do not mix in print() */
     void vprintf(const char *fmt, va_list ap) {
-        vprint(fmt, ap);
-        flush();
+        if (_ready) {
+            vprint(fmt, ap);
+            flush();
+            return;
+        }
+        if (enabled()) {
+            vwrite(fmt, ap);
+        }
+    }
+
+    /* one line whatever the level, for callers that filtered already */
+    void vwrite(const char *fmt, va_list ap) {
+        void *context = _printer->prepare(_type);
+        _printer->vprint(context, fmt, ap);
+        _printer->flush(context);
+    }
+
+    void write(const char *fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        vwrite(fmt, ap);
+        va_end(ap);
     }
 
     void printf(const char *fmt, ...) {
         va_list ap;
         va_start(ap, fmt);
-        vprint(fmt, ap);
-        flush();
+        vprintf(fmt, ap);
+        va_end(ap);
     }
 
     void operator()(const char *fmt, ...) {
         va_list ap;
         va_start(ap, fmt);
-        vprint(fmt, ap);
-        flush();
+        vprintf(fmt, ap);
+        va_end(ap);
     }
 
     static void set_printter(log_printer *printer = nullptr);
@@ -76,5 +158,130 @@ extern log info;
 extern log debug;
 extern log error;
 
+/* a named channel with its own threshold, or the global one until it is given
+ * one. declared with ll_log_module, looked up by name for configuration. the
+ * declaration is static, a module declared in a header has one instance per
+ * translation unit, all under the same name. */
+class log_module {
+private:
+    static log_module *_modules;
+    const char *_name;
+    std::atomic<int> _level;
+    log_module *_next;
+
+public:
+    static constexpr int inherit = -1;
+
+    log_module(const char *name, int level = inherit) : _name(name), _level(level), _next(_modules) {
+        _modules = this;
+    }
+    log_module(const log_module&) = delete;
+    log_module &operator=(const log_module&) = delete;
+
+    const char *name() {
+        return _name;
+    }
+
+    void set_level(int level) {
+        _level.store(level, std::memory_order_relaxed);
+    }
+
+    int get_level() {
+        int level = _level.load(std::memory_order_relaxed);
+        return level == inherit ? log::get_level() : level;
+    }
+
+    bool enabled(int type) {
+        return type >= get_level();
+    }
+
+    /* the first instance with the name */
+    static log_module *find(const char *name);
+
+    /* every instance with the name, e_notexists if there is none */
+    static int set_level(const char *name, int level);
+};
+
+/* lets through burst lines per second from one call site and counts the rest,
+ * the count goes out with the next line let through */
+class log_ratelimit {
+private:
+    unsigned _burst;
+    std::atomic<long long> _window;
+    std::atomic<unsigned> _count;
+    std::atomic<unsigned> _suppressed;
+
+    static long long now_ms() {
+        struct ::timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+
+public:
+    constexpr log_ratelimit(unsigned burst) : _burst(burst), _window(0), _count(0), _suppressed(0) {}
+
+    bool allow() {
+        long long now = now_ms();
+        long long window = _window.load(std::memory_order_relaxed);
+        if (now - window >= 1000 && _window.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+            _count.store(0, std::memory_order_relaxed);
+        }
+        if (_count.fetch_add(1, std::memory_order_relaxed) < _burst) {
+            return true;
+        }
+        _suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    unsigned take_suppressed() {
+        return _suppressed.exchange(0, std::memory_order_relaxed);
+    }
+};
+
 }
+
+/* arguments are not evaluated when the line is filtered, at compile time by
+ * LL_LOG_LEVEL or at run time by the level of log or of the module */
+#define ll_log(type, fmt, ...)                                                  \
+    do {                                                                        \
+        if ((type) >= LL_LOG_LEVEL && ll::log::enabled(type)) {                 \
+            ll::log(type).write(fmt, ##__VA_ARGS__);                           \
+        }                                                                       \
+    } while (0)
+
+#define ll_debug(fmt, ...)      ll_log(ll::log_type_debug, fmt, ##__VA_ARGS__)
+#define ll_info(fmt, ...)       ll_log(ll::log_type_info, fmt, ##__VA_ARGS__)
+#define ll_error(fmt, ...)      ll_log(ll::log_type_error, fmt, ##__VA_ARGS__)
+
+#define ll_log_module(name, ...) static ll::log_module name(#name, ##__VA_ARGS__)
+
+#define ll_mlog(module, type, fmt, ...)                                         \
+    do {                                                                        \
+        if ((type) >= LL_LOG_LEVEL && (module).enabled(type)) {                 \
+            ll::log(type).write(fmt, ##__VA_ARGS__);                           \
+        }                                                                       \
+    } while (0)
+
+#define ll_mdebug(module, fmt, ...) ll_mlog(module, ll::log_type_debug, fmt, ##__VA_ARGS__)
+#define ll_minfo(module, fmt, ...)  ll_mlog(module, ll::log_type_info, fmt, ##__VA_ARGS__)
+#define ll_merror(module, fmt, ...) ll_mlog(module, ll::log_type_error, fmt, ##__VA_ARGS__)
+
+/* at most burst lines per second from this call site */
+#define ll_log_ratelimit(burst, type, fmt, ...)                                 \
+    do {                                                                        \
+        if ((type) >= LL_LOG_LEVEL && ll::log::enabled(type)) {                 \
+            static ll::log_ratelimit __ll_ratelimit(burst);                     \
+            if (__ll_ratelimit.allow()) {                                       \
+                unsigned __suppressed = __ll_ratelimit.take_suppressed();       \
+                if (__suppressed) {                                             \
+                    ll::log(type).write("%u similar lines suppressed\n",        \
+                                        __suppressed);                          \
+                }                                                               \
+                ll::log(type).write(fmt, ##__VA_ARGS__);                       \
+            }                                                                   \
+        }                                                                       \
+    } while (0)
+
+#define ll_error_ratelimit(burst, fmt, ...) ll_log_ratelimit(burst, ll::log_type_error, fmt, ##__VA_ARGS__)
+
 #endif
@@ -1,6 +1,8 @@
 #ifndef __LIBLLPP_MAP_H__
 #define __LIBLLPP_MAP_H__
 
+#include <type_traits>
+
 #include "rbtree.h"
 #include "allocator.h"
 #include "compare.h"
@@ -10,6 +12,9 @@ namespace ll {
 
 typedef rbtree::node map_entry;
 
+/* an entry of this type keeps subtree sizes, the map then offers rank and select */
+typedef rbtree::counted_node counted_map_entry;
+
 #define __LL_MAP_OBJECT__(node) static_cast<value_type*>(containerof_member(static_cast<entry_type*>(node), __field))
 
 template <
@@ -32,6 +37,8 @@ public:
     typedef _GetKey                         getkey_type;
     typedef _Compare                        compare_type;
 
+    static constexpr bool counted = std::is_base_of<rbtree::counted_node, entry_type>::value;
+
     class iterator {
         friend class map;
     private:
@@ -248,6 +255,26 @@ private:
     };
 
     impl _impl;
+
+    static const rbtree::augment *augment() noexcept {
+        return counted ? &rbtree::counted : nullptr;
+    }
+
+    /* replaces the whole tree by n entries chained through _right, last is the tail */
+    void build_chain(map_entry *chain, size_t n, map_entry *last) noexcept {
+        _impl.init();
+        if (__left_acc) {
+            _impl.set_left(chain);
+        }
+        if (__right_acc) {
+            _impl.set_right(last);
+        }
+        _impl.build(chain, n, augment());
+    }
+
+    static key_type key_of(map_entry *node) noexcept {
+        return getkey_type::get_key(__LL_MAP_OBJECT__(node));
+    }
 public:
     map() noexcept : _impl() {}
     map(allocator_type &a) noexcept : _impl(a) {}
@@ -333,7 +360,7 @@ public:
         }
 
         _impl.link(node, parent, link);
-        _impl.insert(node);
+        _impl.insert(node, augment());
 
         if (flag) {
             *flag = 1;
@@ -404,7 +431,7 @@ public:
         }
 
         _impl.link(node, parent, link);
-        _impl.insert(node);
+        _impl.insert(node, augment());
 
         return elm;
     }
@@ -420,6 +447,9 @@ public:
         }
 
         _impl.replace(maped_node, new_node);
+        if (counted) {
+            static_cast<rbtree::counted_node*>(new_node)->_size = static_cast<rbtree::counted_node*>(maped_node)->_size;
+        }
         return maped;
     }
 
@@ -465,7 +495,7 @@ public:
         }
 
         _impl.link(node, parent, link);
-        _impl.insert(node);
+        _impl.insert(node, augment());
 
         return nullptr;
     }
@@ -479,7 +509,7 @@ public:
         if (__right_acc && _impl.get_right() == node) {
             _impl.set_right(node->prev());
         }
-        _impl.remove(node);
+        _impl.remove(node, augment());
         return elm;
     }
 
@@ -491,6 +521,151 @@ public:
         return elm;
     }
 
+    /* the first element not less than key */
+    iterator lower_bound(key_type key) noexcept {
+        map_entry *node = _impl._root;
+        map_entry *bound = nullptr;
+
+        while (node) {
+            if (compare_type::compare(getkey_type::get_key(__LL_MAP_OBJECT__(node)), key) < 0) {
+                node = node->_right;
+            }
+            else {
+                bound = node;
+                node = node->_left;
+            }
+        }
+        return iterator(bound);
+    }
+
+    /* the first element greater than key */
+    iterator upper_bound(key_type key) noexcept {
+        map_entry *node = _impl._root;
+        map_entry *bound = nullptr;
+
+        while (node) {
+            if (compare_type::compare(getkey_type::get_key(__LL_MAP_OBJECT__(node)), key) <= 0) {
+                node = node->_right;
+            }
+            else {
+                bound = node;
+                node = node->_left;
+            }
+        }
+        return iterator(bound);
+    }
+
+    class range_type {
+        friend class map;
+    private:
+        iterator _first;
+        iterator _last;
+        range_type(iterator first, iterator last) noexcept : _first(first), _last(last) {}
+    public:
+        iterator begin() noexcept {
+            return _first;
+        }
+
+        iterator end() noexcept {
+            return _last;
+        }
+    };
+
+    /* the elements with keys in [first, last), for range for */
+    range_type range(key_type first, key_type last) noexcept {
+        return range_type(lower_bound(first), lower_bound(last));
+    }
+
+    /* the map must be empty. [first, last) yields value_type* in key order,
+     * e.g. a sorted snapshot. O(n), nothing is compared or rebalanced */
+    template <typename _Iterator>
+    void build(_Iterator first, _Iterator last) noexcept {
+        map_entry head;
+        map_entry *tail = &head;
+        size_t n = 0;
+
+        for (; first != last; ++first) {
+            map_entry *node = &((*first)->*__field);
+            tail->_right = node;
+            tail = node;
+            n++;
+        }
+        tail->_right = nullptr;
+        build_chain(head._right, n, n ? tail : nullptr);
+    }
+
+    /* moves every element of other in, O(n + m). equal keys are all kept,
+     * this map's first */
+    void merge(map &other) noexcept {
+        size_t n, m;
+        map_entry *a = _impl.flatten(&n);
+        map_entry *b = other._impl.flatten(&m);
+        other._impl.init();
+
+        map_entry head;
+        map_entry *tail = &head;
+        while (a && b) {
+            if (compare_type::compare(key_of(b), key_of(a)) < 0) {
+                tail->_right = b;
+                tail = b;
+                b = b->_right;
+            }
+            else {
+                tail->_right = a;
+                tail = a;
+                a = a->_right;
+            }
+        }
+        tail->_right = a ? a : b;
+        while (tail->_right) {
+            tail = tail->_right;
+        }
+        build_chain(head._right, n + m, n + m ? tail : nullptr);
+    }
+
+    /* moves the elements with keys not less than key into other, which must be empty. O(n) */
+    void split(key_type key, map &other) noexcept {
+        size_t n, left = 0;
+        map_entry head;
+        map_entry *tail = &head;
+
+        head._right = _impl.flatten(&n);
+        while (tail->_right && compare_type::compare(key_of(tail->_right), key) < 0) {
+            tail = tail->_right;
+            left++;
+        }
+        map_entry *rest = tail->_right;
+        tail->_right = nullptr;
+        build_chain(head._right, left, left ? tail : nullptr);
+
+        map_entry *last = rest;
+        if (last) {
+            while (last->_right) {
+                last = last->_right;
+            }
+        }
+        other.build_chain(rest, n - left, last);
+    }
+
+    /* counted entries only */
+    size_t count() noexcept {
+        static_assert(counted, "map::count() needs a counted_map_entry");
+        return rbtree::counted_node::size(_impl._root);
+    }
+
+    /* the number of elements before elm */
+    size_t rank(value_type *elm) noexcept {
+        static_assert(counted, "map::rank() needs a counted_map_entry");
+        return rbtree::rank(static_cast<rbtree::counted_node*>(&(elm->*__field)));
+    }
+
+    /* the element at index i in key order */
+    value_type *select(size_t i) noexcept {
+        static_assert(counted, "map::select() needs a counted_map_entry");
+        map_entry *node = _impl.select(i);
+        return node ? __LL_MAP_OBJECT__(node) : nullptr;
+    }
+
     iterator begin() noexcept {
         return iterator(_impl.get_left());
     }
@@ -233,7 +233,7 @@ void page_allocator::free(page *pg)
 
         while (order < max_order) {
             buddy_index = node->_index ^ (1 << (order - min_order));
-            buddy = node + (buddy_index - node->_index);
+            buddy = node + ((int)buddy_index - (int)node->_index);
             if (order != buddy->_order) {
                 node->_order = order;
                 break;
@@ -3,7 +3,7 @@
 
 namespace ll {
 
-inline void rbtree::rotate_left(register rbtree::node *n) noexcept 
+inline void rbtree::rotate_left(register rbtree::node *n, const augment *aug) noexcept 
 {
     register node *right = n->_right;
     register node *parent = n->parent();
@@ -28,9 +28,12 @@ inline void rbtree::rotate_left(register rbtree::node *n) noexcept
     }
 
     n->set_parent(right);
+    if (aug) {
+        aug->rotate(n, right);
+    }
 }
 
-inline void rbtree::rotate_right(register node *n) noexcept 
+inline void rbtree::rotate_right(register node *n, const augment *aug) noexcept 
 {
     register node *left = n->_left;
     register node *parent = n->parent();
@@ -54,12 +57,19 @@ inline void rbtree::rotate_right(register node *n) noexcept
         _root = left;
     }
     n->set_parent(left);
+    if (aug) {
+        aug->rotate(n, left);
+    }
 }
 
-void rbtree::insert(node *n) noexcept 
+void rbtree::insert(node *n, const augment *aug) noexcept 
 {
     node *parent, *gparent;
 
+    if (aug) {
+        aug->propagate(n);
+    }
+
     while ((parent = n->parent()) && parent->is_red()) {
         gparent = parent->parent();
 
@@ -77,7 +87,7 @@ void rbtree::insert(node *n) noexcept
 
             if (parent->_right == n) {
                 register node *tmp;
-                rotate_left(parent);
+                rotate_left(parent, aug);
                 tmp = parent;
                 parent = n;
                 n = tmp;
@@ -85,7 +95,7 @@ void rbtree::insert(node *n) noexcept
 
             parent->set_black();
             gparent->set_red();
-            rotate_right(gparent);
+            rotate_right(gparent, aug);
         }
         else {
             {
@@ -101,7 +111,7 @@ void rbtree::insert(node *n) noexcept
 
             if (parent->_left == n) {
                 register node *tmp;
-                rotate_right(parent);
+                rotate_right(parent, aug);
                 tmp = parent;
                 parent = n;
                 n = tmp;
@@ -109,14 +119,14 @@ void rbtree::insert(node *n) noexcept
 
             parent->set_black();
             gparent->set_red();
-            rotate_left(gparent);
+            rotate_left(gparent, aug);
         }
     }
 
     _root->set_black();
 }
 
-inline void rbtree::erase_color(node *n, node *parent) noexcept 
+inline void rbtree::erase_color(node *n, node *parent, const augment *aug) noexcept 
 {
     node *other;
 
@@ -126,7 +136,7 @@ inline void rbtree::erase_color(node *n, node *parent) noexcept
             if (other->is_red()) {
                 other->set_black();
                 parent->set_red();
-                rotate_left(parent);
+                rotate_left(parent, aug);
                 other = parent->_right;
             }
             if ((!other->_left || other->_left->is_black()) &&
@@ -142,7 +152,7 @@ inline void rbtree::erase_color(node *n, node *parent) noexcept
                         o_left->set_black();
                     }
                     other->set_red();
-                    rotate_right(other);
+                    rotate_right(other, aug);
                     other = parent->_right;
                 }
                 other->set_color(parent->color());
@@ -150,7 +160,7 @@ inline void rbtree::erase_color(node *n, node *parent) noexcept
                 if (other->_right) {
                     other->_right->set_black();
                 }
-                rotate_left(parent);
+                rotate_left(parent, aug);
                 n = _root;
                 break;
             }
@@ -160,7 +170,7 @@ inline void rbtree::erase_color(node *n, node *parent) noexcept
             if (other->is_red()) {
                 other->set_black();
                 parent->set_red();
-                rotate_right(parent);
+                rotate_right(parent, aug);
                 other = parent->_left;
             }
             if ((!other->_left || other->_left->is_black()) &&
@@ -176,7 +186,7 @@ inline void rbtree::erase_color(node *n, node *parent) noexcept
                         o_right->set_black();
                     }
                     other->set_red();
-                    rotate_left(other);
+                    rotate_left(other, aug);
                     other = parent->_left;
                 }
                 other->set_color(parent->color());
@@ -184,7 +194,7 @@ inline void rbtree::erase_color(node *n, node *parent) noexcept
                 if (other->_left) {
                     other->_left->set_black();
                 }
-                rotate_right(parent);
+                rotate_right(parent, aug);
                 n = _root;
                 break;
             }
@@ -195,7 +205,7 @@ inline void rbtree::erase_color(node *n, node *parent) noexcept
     }
 }
 
-void rbtree::remove(node *n) noexcept 
+void rbtree::remove(node *n, const augment *aug) noexcept 
 {
     node *child, *parent;
     unsigned color;
@@ -270,8 +280,12 @@ void rbtree::remove(node *n) noexcept
     }
 
 color:
+    /* every node from the gap up has lost one below it, the moved successor included */
+    if (aug && parent) {
+        aug->propagate(parent);
+    }
     if (color == node::black) {
-        erase_color(child, parent);
+        erase_color(child, parent, aug);
     }
 }
 
@@ -302,4 +316,128 @@ void rbtree::replace(node *victim, node *new_node) noexcept
     *new_node = *victim;
 }
 
+static void counted_propagate(rbtree::node *n) noexcept
+{
+    while (n) {
+        static_cast<rbtree::counted_node*>(n)->update();
+        n = n->parent();
+    }
+}
+
+/* n took old's place, so it covers what old did */
+static void counted_rotate(rbtree::node *old, rbtree::node *n) noexcept
+{
+    static_cast<rbtree::counted_node*>(n)->_size = static_cast<rbtree::counted_node*>(old)->_size;
+    static_cast<rbtree::counted_node*>(old)->update();
+}
+
+static void counted_update(rbtree::node *n) noexcept
+{
+    static_cast<rbtree::counted_node*>(n)->update();
+}
+
+const rbtree::augment rbtree::counted = {counted_propagate, counted_rotate, counted_update};
+
+size_t rbtree::rank(counted_node *n) noexcept
+{
+    size_t r = counted_node::size(n->_left);
+    node *parent;
+    for (node *x = n; (parent = x->parent()); x = parent) {
+        if (x == parent->_right) {
+            r += counted_node::size(parent->_left) + 1;
+        }
+    }
+    return r;
+}
+
+rbtree::counted_node *rbtree::select(size_t i) noexcept
+{
+    node *n = _root;
+    while (n) {
+        size_t left = counted_node::size(n->_left);
+        if (i < left) {
+            n = n->_left;
+        }
+        else if (i > left) {
+            i -= left + 1;
+            n = n->_right;
+        }
+        else {
+            break;
+        }
+    }
+    return static_cast<counted_node*>(n);
+}
+
+/* subtree sizes differ by at most one at every node, so all nodes sit above
+ * depth floor(log2 n) except some on that level. those are red, the rest black,
+ * which gives every path the same number of black nodes. */
+rbtree::node *rbtree::build(node *&chain, size_t n, unsigned depth, unsigned red_depth, const augment *aug) noexcept
+{
+    if (!n) {
+        return nullptr;
+    }
+
+    size_t left_count = (n - 1) / 2;
+    node *left = build(chain, left_count, depth + 1, red_depth, aug);
+    node *root = chain;
+    chain = chain->_right;
+    node *right = build(chain, n - 1 - left_count, depth + 1, red_depth, aug);
+
+    root->_parent_color = depth == red_depth ? node::red : node::black;
+    root->_left = left;
+    root->_right = right;
+    if (left) {
+        left->set_parent(root);
+    }
+    if (right) {
+        right->set_parent(root);
+    }
+    if (aug) {
+        aug->update(root);
+    }
+    return root;
+}
+
+void rbtree::build(node *chain, size_t n, const augment *aug) noexcept
+{
+    unsigned depth = 0;
+    while ((n >> depth) > 1) {
+        depth++;
+    }
+    /* a single node is the root, which stays black */
+    _root = build(chain, n, 0, depth ? depth : ~0U, aug);
+}
+
+rbtree::node *rbtree::flatten(size_t *count) noexcept
+{
+    /* red-black height is at most 2 log2(n + 1) */
+    node *stack[2 * sizeof(size_t) * 8];
+    unsigned sp = 0;
+    size_t n = 0;
+    node head;
+    node *tail = &head;
+    node *x = _root;
+
+    while (x || sp) {
+        while (x) {
+            stack[sp++] = x;
+            x = x->_left;
+        }
+        x = stack[--sp];
+        node *right = x->_right;
+        tail->_right = x;
+        tail = x;
+        n++;
+        x = right;
+    }
+    tail->_right = nullptr;
+
+    _root = nullptr;
+    if (count) {
+        *count = n;
+    }
+    return head._right;
+}
+
 }
@@ -1,6 +1,8 @@
 #ifndef __LIBLLPP_RBTREE_H__
 #define __LIBLLPP_RBTREE_H__
 
+#include <cstddef>
+
 namespace ll {
 
 class rbtree {
@@ -99,13 +101,38 @@ public:
         }
     };
 
+    /* keeps a value computed from a node and its subtrees up to date.
+     * propagate recomputes n and every ancestor, rotate is called after n
+     * took old's place and old became its child, update recomputes n alone. */
+    struct augment {
+        void (*propagate)(node *n);
+        void (*rotate)(node *old, node *n);
+        void (*update)(node *n);
+    };
+
+    /* subtree size, for rank and select */
+    struct counted_node : node {
+        size_t _size;
+
+        static size_t size(node *n) noexcept {
+            return n ? static_cast<counted_node*>(n)->_size : 0;
+        }
+
+        void update() noexcept {
+            _size = 1 + size(_left) + size(_right);
+        }
+    };
+
+    static const augment counted;
+
 protected:
     node *_root;
 
 private:
-    void rotate_left(register node *n) noexcept;
-    void rotate_right(register node *n) noexcept;
-    void erase_color(node *n, node *parent) noexcept;
+    void rotate_left(register node *n, const augment *aug) noexcept;
+    void rotate_right(register node *n, const augment *aug) noexcept;
+    void erase_color(node *n, node *parent, const augment *aug) noexcept;
+    static node *build(node *&chain, size_t n, unsigned depth, unsigned red_depth, const augment *aug) noexcept;
 
 public:
     rbtree() : _root() {}
@@ -148,10 +175,21 @@ public:
         *link = n;
     }
 
-    void insert(node *n) noexcept;
-    void remove(node *n) noexcept;
+    void insert(node *n, const augment *aug = nullptr) noexcept;
+    void remove(node *n, const augment *aug = nullptr) noexcept;
     void replace(node *victim, node *new_node) noexcept;
 
+    /* the tree must be empty. chain holds n nodes in order, linked through _right.
+     * links them as a balanced tree and colours it directly, O(n) */
+    void build(node *chain, size_t n, const augment *aug = nullptr) noexcept;
+
+    /* unlinks every node into an ordered chain through _right and empties the tree, O(n) */
+    node *flatten(size_t *count = nullptr) noexcept;
+
+    /* counted trees only: the number of nodes before n, and the node at index i */
+    static size_t rank(counted_node *n) noexcept;
+    counted_node *select(size_t i) noexcept;
+
 };
 
 }
@@ -29,6 +29,7 @@ enum rc {
     e_busy = ll_sys_rc(EBUSY),
     e_timedout = ll_sys_rc(ETIMEDOUT),
     e_inval = ll_sys_rc(EINVAL),
+    e_notsupport = ll_sys_rc(EOPNOTSUPP),
 };
 
 }
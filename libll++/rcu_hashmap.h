@@ -0,0 +1,220 @@
+#ifndef __LIBLLPP_RCU_HASHMAP_H__
+#define __LIBLLPP_RCU_HASHMAP_H__
+
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#include "hash.h"
+#include "compare.h"
+#include "epoch.h"
+
+namespace ll {
+
+/* read-mostly concurrent map. lookups take no lock and never wait, writers
+ * serialize on a mutex and publish with release stores. replaced or removed
+ * nodes and outgrown tables are retired to an epoch_domain, so a pointer
+ * returned by get() stays valid until the reader's next quiescent state. */
+template <
+    typename _Key,
+    typename _T,
+    typename _Hash = hash<_Key>,
+    typename _Compare = equal_compare<_Key>>
+class rcu_hashmap {
+public:
+    typedef _Key                                    key_t;
+    typedef _T                                      type_t;
+    typedef _Hash                                   hash_make_t;
+    typedef _Compare                                compare_t;
+
+    static constexpr size_t min_capacity            = 16;
+
+private:
+    struct node {
+        std::atomic<node*> _next;
+        hash_t _hash;
+        _Key _key;
+        _T _value;
+
+        template <typename ...Args>
+        node(node *next, hash_t hash, key_t key, Args&&...args) :
+            _next(next), _hash(hash), _key(key), _value(std::forward<Args>(args)...) {}
+    };
+
+    struct table {
+        size_t _mask;
+        std::atomic<node*> _buckets[1];
+    };
+
+    epoch_domain *_domain;
+    std::atomic<table*> _table;
+    std::mutex _mutex;
+    size_t _count;
+
+    template <typename ...Args>
+    static node *new_node(node *next, hash_t hash, key_t key, Args&&...args) {
+        return new (std::malloc(sizeof(node))) node(next, hash, key, std::forward<Args>(args)...);
+    }
+
+    static void free_node(void *p) {
+        static_cast<node*>(p)->~node();
+        std::free(p);
+    }
+
+    static table *new_table(size_t capacity) {
+        table *t = (table*)std::malloc(sizeof(table) + sizeof(std::atomic<node*>) * (capacity - 1));
+        t->_mask = capacity - 1;
+        for (size_t i = 0; i < capacity; i++) {
+            new (t->_buckets + i) std::atomic<node*>(nullptr);
+        }
+        return t;
+    }
+
+    /* the nodes of an outgrown table were copied, they go with it */
+    static void free_table(void *p) {
+        table *t = static_cast<table*>(p);
+        for (size_t i = 0; i <= t->_mask; i++) {
+            node *n = t->_buckets[i].load(std::memory_order_relaxed);
+            while (n) {
+                node *next = n->_next.load(std::memory_order_relaxed);
+                free_node(n);
+                n = next;
+            }
+        }
+        std::free(t);
+    }
+
+    /* caller holds _mutex. returns the link pointing at key, or the end of the chain */
+    static std::atomic<node*> *find_link(table *t, key_t key, hash_t hash) {
+        std::atomic<node*> *link = t->_buckets + (hash & t->_mask);
+        node *n;
+        while ((n = link->load(std::memory_order_relaxed))) {
+            if (n->_hash == hash && !compare_t::compare(key, n->_key)) {
+                break;
+            }
+            link = &n->_next;
+        }
+        return link;
+    }
+
+    /* copy every node into a table twice as large, then publish it */
+    void grow(table *t) {
+        size_t capacity = (t->_mask + 1) << 1;
+        table *nt = new_table(capacity);
+        for (size_t i = 0; i <= t->_mask; i++) {
+            for (node *n = t->_buckets[i].load(std::memory_order_relaxed); n; n = n->_next.load(std::memory_order_relaxed)) {
+                std::atomic<node*> &bucket = nt->_buckets[n->_hash & nt->_mask];
+                bucket.store(new_node(bucket.load(std::memory_order_relaxed), n->_hash, n->_key, n->_value),
+                             std::memory_order_relaxed);
+            }
+        }
+        _table.store(nt, std::memory_order_release);
+        _domain->retire(t, free_table);
+    }
+
+public:
+    rcu_hashmap(epoch_domain *domain = nullptr, size_t initsize = min_capacity) :
+        _domain(domain ? domain : epoch_domain::global()), _table(), _mutex(), _count(0)
+    {
+        size_t capacity = min_capacity;
+        while (capacity < initsize) {
+            capacity <<= 1;
+        }
+        _table.store(new_table(capacity), std::memory_order_relaxed);
+    }
+
+    rcu_hashmap(const rcu_hashmap&) = delete;
+    rcu_hashmap &operator=(const rcu_hashmap&) = delete;
+
+    /* no reader may still be inside the map */
+    ~rcu_hashmap() {
+        free_table(_table.load(std::memory_order_relaxed));
+    }
+
+    epoch_domain *get_epoch_domain() {
+        return _domain;
+    }
+
+    size_t count() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _count;
+    }
+
+    /* wait-free. valid until the calling thread's next quiescent state */
+    const type_t *get(key_t key) const {
+        hash_t hash = hash_make_t::make(key);
+        table *t = _table.load(std::memory_order_acquire);
+        node *n = t->_buckets[hash & t->_mask].load(std::memory_order_acquire);
+        while (n) {
+            if (n->_hash == hash && !compare_t::compare(key, n->_key)) {
+                return &n->_value;
+            }
+            n = n->_next.load(std::memory_order_acquire);
+        }
+        return nullptr;
+    }
+
+    bool get(key_t key, type_t &value) const {
+        const type_t *p = get(key);
+        if (p) {
+            value = *p;
+            return true;
+        }
+        return false;
+    }
+
+    /* insert or replace, returns true if key was new. a replaced value is a new
+     * node, readers holding the old one keep seeing it until they quiesce. */
+    template <typename ...Args>
+    bool set(key_t key, Args&&...args) {
+        hash_t hash = hash_make_t::make(key);
+        std::lock_guard<std::mutex> lock(_mutex);
+        table *t = _table.load(std::memory_order_relaxed);
+        std::atomic<node*> *link = find_link(t, key, hash);
+        node *old = link->load(std::memory_order_relaxed);
+
+        if (old) {
+            node *n = new_node(old->_next.load(std::memory_order_relaxed), hash, key, std::forward<Args>(args)...);
+            link->store(n, std::memory_order_release);
+            _domain->retire(old, free_node);
+            return false;
+        }
+
+        std::atomic<node*> &bucket = t->_buckets[hash & t->_mask];
+        bucket.store(new_node(bucket.load(std::memory_order_relaxed), hash, key, std::forward<Args>(args)...),
+                     std::memory_order_release);
+        if (++_count > t->_mask + 1) {
+            grow(t);
+        }
+        return true;
+    }
+
+    bool remove(key_t key) {
+        hash_t hash = hash_make_t::make(key);
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::atomic<node*> *link = find_link(_table.load(std::memory_order_relaxed), key, hash);
+        node *n = link->load(std::memory_order_relaxed);
+        if (!n) {
+            return false;
+        }
+        link->store(n->_next.load(std::memory_order_relaxed), std::memory_order_release);
+        _domain->retire(n, free_node);
+        _count--;
+        return true;
+    }
+
+    /* readers may still walk the old chains, they are retired as one table */
+    void clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        table *t = _table.load(std::memory_order_relaxed);
+        _table.store(new_table(min_capacity), std::memory_order_release);
+        _domain->retire(t, free_table);
+        _count = 0;
+    }
+};
+
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <errno.h>
 
 #include "reactor.h"
+#include "epoch.h"
 #include "etc.h"
 #include "rc.h"
 #include "log.h"
@@ -15,12 +16,6 @@ namespace ll {
 unsigned reactor::_default_maxfds = default_maxfds;
 unsigned reactor::_default_maxevents = default_maxevents;
 
-inline void reactor::io::deattch() 
-{
-    file_io::deattch();
-    disconnect();
-}
-
 reactor::reactor(unsigned maxfds, unsigned maxevents) noexcept
     : reactor(pool::global(), maxfds, maxevents)
 {
@@ -29,7 +24,8 @@ reactor::reactor(unsigned maxfds, unsigned maxevents) noexcept
 reactor::reactor(pool *pool, unsigned maxfds, unsigned maxevents) noexcept :
     _pool(pool),
     _maxfds(maxfds ? (maxfds < minfds ? minfds : maxfds) : _default_maxfds),
-    _maxevents(maxevents ? (maxevents < minevents ? minevents : maxevents) : _default_maxevents)
+    _maxevents(maxevents ? (maxevents < minevents ? minevents : maxevents) : _default_maxevents),
+    _epoch()
 {
     _fds = (io**)_pool->calloc(sizeof(io*) * _maxfds);
     _events = (struct ::epoll_event*)_pool->alloc(sizeof(struct ::epoll_event) * _maxevents);
@@ -112,18 +108,25 @@ int reactor::open(int fd, unsigned flags)
     return ok;
 }
 
-int reactor::close(int fd, bool linger)
+/* the fd leaves epoll, its io is still attached */
+int reactor::unwatch(int fd)
 {
     if (!ll_fd_valid(fd) && (unsigned)fd >= _maxfds) {
         return e_inval;
     }
 
-    io *io = _fds[fd];
-    if (!io) {
+    if (!_fds[fd]) {
         return e_inval;
     }
 
     ll_sys_failed_return(epoll_ctl(_fd, EPOLL_CTL_DEL, fd, nullptr));
+    return ok;
+}
+
+int reactor::close(int fd, bool linger)
+{
+    ll_failed_return(unwatch(fd));
+    io *io = _fds[fd];
     io->emit(*io, poll_close);
     io->deattch();
     return ok;
@@ -169,49 +172,60 @@ int reactor::modify(int fd, int flags)
     return ok;
 }
 
-int reactor::loop(timeval tv)
+/* the number of ready events, or an error */
+int reactor::wait(int timeout)
 {
-    int nfds, flags;
-    struct epoll_event *event;
-    io *io;
-    int timeout = time_prec_msec::to_precval(tv);
-    if (!timeout) {
-        return ok;
+    int nfds;
+    if (_epoch) {
+        _epoch->offline();
     }
     nfds = epoll_wait(_fd, _events, _maxevents, timeout);
+    if (_epoch) {
+        _epoch->online();
+    }
 
     if (ll_unlikely(nfds == -1)) {
         if (ll_likely(errno == EINTR)) {
-            return ok;
+            return 0;
         }
         return ll_sys_rc(errno);
     }
-    else if (ll_likely(nfds > 0)) {
-        for (event = _events; nfds--; event++) {
-            io = _fds[event->data.fd];
-            if (io->connected()) {
-                flags = 0;
-                if (event->events & EPOLLIN) {
-                    flags |= poll_in;
-                }
-                if (event->events & EPOLLOUT) {
-                    flags |= poll_out;
-                }
-                if (event->events & EPOLLERR) {
-                    flags |= poll_err;
-                }
+    return nfds;
+}
+
+/* null when the fd was closed by an earlier handler of the same round */
+reactor::io *reactor::ready(unsigned n, int *flags)
+{
+    struct epoll_event *event = _events + n;
+    io *io = _fds[event->data.fd];
+    if (!io || !io->opened()) {
+        return nullptr;
+    }
+
+    int f = 0;
+    if (event->events & EPOLLIN) {
+        f |= poll_in;
+    }
+    if (event->events & EPOLLOUT) {
+        f |= poll_out;
+    }
+    if (event->events & EPOLLERR) {
+        f |= poll_err;
+    }
 #ifdef EPOLLRDHUP
-                if (event->events & EPOLLRDHUP) {
-                    flags |= poll_hup;
-                }
+    if (event->events & EPOLLRDHUP) {
+        f |= poll_hup;
+    }
 #endif
-                if (ll_failed(io->emit(*io, flags))) {
-                    close(event->data.fd);
-                }
-            }
-        }
+    *flags = f;
+    return io;
+}
+
+void reactor::dispatched()
+{
+    if (_epoch) {
+        _epoch->quiescent();
     }
-    return ok;
 }
 
 }
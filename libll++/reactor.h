@@ -3,6 +3,8 @@
 
 #include <cassert>
 
+#include "etc.h"
+#include "rc.h"
 #include "pool.h"
 #include "slotsig.h"
 #include "file_io.h"
@@ -12,6 +14,8 @@ struct epoll_event;
 
 namespace ll {
 
+class epoch_domain;
+
 class reactor {
 public:
     static constexpr unsigned poll_in           = (1 << 0);
@@ -29,7 +33,10 @@ public:
     class io : public file_io, public signal<int(io&, int), true> {
         friend class reactor;
     private:
-        void deattch();
+        void deattch() {
+            file_io::deattch();
+            disconnect();
+        }
     public:
         io() : file_io(), signal<int(io&, int), true>() {}
     };
@@ -45,8 +52,13 @@ private:
     io **_fds;
     void *_stub;
     struct ::epoll_event *_events;
+    epoch_domain *_epoch;
 
     void dispose();
+    int unwatch(int fd);
+    int wait(int timeout);
+    io *ready(unsigned n, int *flags);
+    void dispatched();
 public:
     reactor(unsigned maxfds = 0, unsigned maxevents = 0) noexcept;
     reactor(pool *pool, unsigned maxfds = 0, unsigned maxevents = 0) noexcept;
@@ -81,7 +93,48 @@ public:
 
     int close(int fd, bool linger = false);
     int modify(int fd, int flags);
-    int loop(timeval tv);
+
+    /* each ready fd emits its own signal */
+    int loop(timeval tv) {
+        return loop(tv, [](io &io, int flags) {
+            return io.emit(io, flags);
+        });
+    }
+
+    /* every ready fd goes to handler(io&, flags) instead, a direct call the
+     * compiler can inline. a failed result closes the fd, the handler then
+     * sees poll_close, the io's signal does not. */
+    template <typename _Handler>
+    int loop(timeval tv, _Handler &&handler) {
+        int timeout = time_prec_msec::to_precval(tv);
+        if (!timeout) {
+            return ok;
+        }
+        int nfds = wait(timeout);
+        if (ll_unlikely(nfds < 0)) {
+            return nfds;
+        }
+        for (int n = 0; n < nfds; n++) {
+            int flags;
+            io *io = ready(n, &flags);
+            if (io && ll_failed(handler(*io, flags)) && ll_ok(unwatch(*io))) {
+                handler(*io, (int)poll_close);
+                io->deattch();
+            }
+        }
+        dispatched();
+        return ok;
+    }
+
+    /* the loop thread goes offline in epoll_wait and passes a quiescent
+     * state after each dispatch, handlers must not keep rcu references */
+    void set_epoch_domain(epoch_domain *domain) {
+        _epoch = domain;
+    }
+
+    epoch_domain *get_epoch_domain() {
+        return _epoch;
+    }
 
     static void set_default_params(unsigned maxfds, unsigned maxevents);
 };
@@ -0,0 +1,306 @@
+#include <cstdio>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "resolver.h"
+
+namespace ll {
+
+static constexpr timeval default_positive_ttl = 60 * time::usecs_of_second;
+static constexpr timeval default_negative_ttl = 5 * time::usecs_of_second;
+
+/* the key is "host/port/family", host and port always fit in as much room */
+resolver::entry::entry(const char *key, const char *host, const char *port, int family) :
+    _expiry(nullptr),
+    _host(),
+    _port(),
+    _family(family),
+    _state(state_empty),
+    _rc(ok),
+    _count(),
+    _expires(),
+    _waiters()
+{
+    strcpy(_key, key);
+    char *p = _names;
+    if (host) {
+        _host = p;
+        p = stpcpy(p, host) + 1;
+    }
+    if (port) {
+        _port = p;
+        strcpy(p, port);
+    }
+}
+
+int resolver::default_lookup(const char *host, const char *port, int family, address *addrs, unsigned *count)
+{
+    struct ::addrinfo hints, *res, *ai;
+
+    memset(&hints, 0, sizeof(struct ::addrinfo));
+    hints.ai_family = family;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    int error = ::getaddrinfo(host && *host ? host : nullptr, port, &hints, &res);
+    if (error) {
+        if (error == EAI_NONAME || error == EAI_NODATA) {
+            return e_notexists;
+        }
+        return fail;
+    }
+
+    unsigned n = 0;
+    for (ai = res; ai && n < max_addrs; ai = ai->ai_next) {
+        if (ll_ok(addrs[n].assign(ai->ai_addr, ai->ai_addrlen))) {
+            n++;
+        }
+    }
+    freeaddrinfo(res);
+
+    *count = n;
+    return n ? ok : e_notexists;
+}
+
+resolver::resolver(reactor *reactor, pool *pool, lookup_type lookup) noexcept :
+    _reactor(reactor),
+    _pool(pool ? pool : pool::global()),
+    _lookup(lookup ? lookup : default_lookup),
+    _positive_ttl(default_positive_ttl),
+    _negative_ttl(default_negative_ttl),
+    _cache(_pool, default_max_entries),
+    _expiry(),
+    _max_entries(default_max_entries),
+    _calling(),
+    _efd(-1),
+    _requests(),
+    _completions(),
+    _stop(false)
+{
+}
+
+resolver::~resolver() noexcept
+{
+    stop();
+    _cache.clear(&mallocator::instance());
+}
+
+int resolver::start()
+{
+    if (ll_fd_valid(_efd)) {
+        return e_busy;
+    }
+
+    ll_sys_failed_return(_efd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    ll_failed_return_ex(_reactor->open(_efd, reactor::poll_in, &resolver::event_handler, this), 
+                        file_io::close(_efd); _efd = -1);
+
+    _stop = false;
+    _thread = std::thread(&resolver::run, this);
+    return ok;
+}
+
+void resolver::stop()
+{
+    if (!ll_fd_valid(_efd)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cond.notify_one();
+    _thread.join();
+
+    _reactor->close(_efd);
+
+    request *r;
+    while ((r = _requests.pop_front())) {
+        _delete<request>(nullptr, r);
+    }
+    while ((r = _completions.pop_front())) {
+        _delete<request>(nullptr, r);
+    }
+
+    for (auto &e : _cache) {
+        waiter *w;
+        while ((w = e._waiters.pop_front())) {
+            w->_closure->apply(*this, e_closed, nullptr, 0);
+            _delete<closure_type>(nullptr, w->_closure);
+            _delete<waiter>(nullptr, w);
+        }
+        if (e._state == entry::state_pending) {
+            e._state = entry::state_empty;
+        }
+    }
+}
+
+void resolver::run()
+{
+    request *r;
+    while (1) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stop && _requests.empty()) {
+                _cond.wait(lock);
+            }
+            if (_stop) {
+                return;
+            }
+            r = _requests.pop_front();
+        }
+
+        entry *e = r->_target;
+        r->_count = 0;
+        r->_rc = _lookup(e->_host, e->_port, e->_family, r->_addrs, &r->_count);
+
+        bool wakeup;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            wakeup = _completions.empty();
+            _completions.push_back(r);
+        }
+
+        if (wakeup) {
+            uint64_t n = 1;
+            while (::write(_efd, &n, sizeof(n)) < 0 && errno == EINTR);
+        }
+    }
+}
+
+void resolver::submit(entry *e)
+{
+    request *r = _new<request>(nullptr);
+    r->_target = e;
+    if (e->_state == entry::state_ready) {
+        _expiry.remove(e);
+    }
+    e->_state = entry::state_pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requests.push_back(r);
+    }
+    _cond.notify_one();
+}
+
+void resolver::complete(entry *e)
+{
+    waiter *w;
+    _calling++;
+    while ((w = e->_waiters.pop_front())) {
+        w->_closure->apply(*this, e->_rc, e->_count ? e->_addrs : nullptr, e->_count);
+        _delete<closure_type>(nullptr, w->_closure);
+        _delete<waiter>(nullptr, w);
+    }
+    _calling--;
+}
+
+int resolver::event_handler(file_io&, int type)
+{
+    if (type & reactor::poll_close) {
+        file_io::close(_efd);
+        _efd = -1;
+        return ok;
+    }
+
+    uint64_t n;
+    while (::read(_efd, &n, sizeof(n)) < 0 && errno == EINTR);
+
+    ll_list(request, _entry) done;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        done = std::move(_completions);
+        _completions.init();
+    }
+
+    timeval now = time_prec_msec::now();
+    request *r;
+    while ((r = done.pop_front())) {
+        entry *e = r->_target;
+        e->_rc = r->_rc;
+        e->_count = ll_ok(r->_rc) ? r->_count : 0;
+        memcpy(e->_addrs, r->_addrs, sizeof(address) * e->_count);
+        e->_expires = now + (ll_ok(r->_rc) ? _positive_ttl : _negative_ttl);
+        e->_state = entry::state_ready;
+        _expiry.push_back(e);
+        _delete<request>(nullptr, r);
+        complete(e);
+    }
+    return ok;
+}
+
+/* only a ready entry is evicted, nothing refers to it but the cache */
+void resolver::evict(entry *e)
+{
+    _expiry.remove(e);
+    _cache.remove(e);
+    _delete<entry>(&mallocator::instance(), e);
+}
+
+/* the positive and negative ttls differ, an entry that expired behind a
+ * live one waits for it */
+void resolver::evict_expired(timeval now)
+{
+    entry *e;
+    while ((e = _expiry.front()) && now >= e->_expires) {
+        evict(e);
+    }
+}
+
+/* the entries go with the next lookup, a callback may still hold their addrs */
+void resolver::flush_cache()
+{
+    for (auto &e : _expiry) {
+        e._expires = 0;
+    }
+}
+
+int resolver::do_resolve(const char *host, const char *port, int family, closure_type *c)
+{
+    char key[max_key_size];
+
+    if (!ll_fd_valid(_efd)) {
+        _delete<closure_type>(nullptr, c);
+        return e_notready;
+    }
+
+    if ((unsigned)snprintf(key, sizeof(key), "%s/%s/%d", host ? host : "", port ? port : "", family) >= sizeof(key)) {
+        _delete<closure_type>(nullptr, c);
+        return e_inval;
+    }
+
+    /* not from a callback, its addrs point into an entry */
+    timeval now = time_prec_msec::now();
+    if (!_calling) {
+        evict_expired(now);
+    }
+
+    entry *e = _cache.get(key);
+    if (!e) {
+        if (!_calling && _cache.count() >= _max_entries && !_expiry.empty()) {
+            evict(_expiry.front());
+        }
+        e = _cache.probe(key, nullptr, &mallocator::instance(), host, port, family);
+    }
+
+    if (e->_state == entry::state_ready && now < e->_expires) {
+        _calling++;
+        c->apply(*this, e->_rc, e->_count ? e->_addrs : nullptr, e->_count);
+        _calling--;
+        _delete<closure_type>(nullptr, c);
+        return ok;
+    }
+
+    /* concurrent lookups of one name share a single request */
+    waiter *w = _new<waiter>(nullptr);
+    w->_closure = c;
+    e->_waiters.push_back(w);
+    if (e->_state != entry::state_pending) {
+        submit(e);
+    }
+    return ok;
+}
+
+}
+
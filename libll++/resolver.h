@@ -0,0 +1,160 @@
+#ifndef __LIBLLPP_RESOLVER_H__
+#define __LIBLLPP_RESOLVER_H__
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "socket.h"
+#include "hashmap.h"
+
+namespace ll {
+
+class resolver {
+public:
+    static constexpr unsigned max_addrs                 = 8;
+    static constexpr unsigned max_key_size              = 320;
+    static constexpr unsigned default_max_entries       = 1024;
+
+    typedef closure<void(resolver&, int, address*, unsigned)> closure_type;
+
+    /* blocking lookup run on the helper thread, fills at most max_addrs */
+    typedef int (*lookup_type)(const char *host, const char *port, int family, address *addrs, unsigned *count);
+
+    static int default_lookup(const char *host, const char *port, int family, address *addrs, unsigned *count);
+
+private:
+    struct waiter {
+        stlist_entry _entry;
+        closure_type *_closure;
+    };
+
+    struct entry {
+        static constexpr unsigned state_empty   = 0;
+        static constexpr unsigned state_pending = 1;
+        static constexpr unsigned state_ready   = 2;
+
+        hashmap_entry<> _entry;
+        clist_entry _expiry;
+        const char *_host;
+        const char *_port;
+        int _family;
+        unsigned _state;
+        int _rc;
+        unsigned _count;
+        timeval _expires;
+        address _addrs[max_addrs];
+        ll_list(waiter, _entry) _waiters;
+        char _key[max_key_size];
+        char _names[max_key_size];
+
+        entry(const char *key, const char *host, const char *port, int family);
+
+        static const char *get_key(entry *e) {
+            return e->_key;
+        }
+    };
+
+    struct request {
+        stlist_entry _entry;
+        entry *_target;
+        int _rc;
+        unsigned _count;
+        address _addrs[max_addrs];
+    };
+
+    struct key_hash {
+        static hash_t make(const char *key) {
+            return hash_string(key);
+        }
+    };
+
+    struct key_compare {
+        static int compare(const char *x, const char *y) {
+            return strcmp(x, y);
+        }
+    };
+
+    /* entries are freed on eviction, the buckets stay in the pool */
+    typedef ll_hashmap(const char*, entry, _entry, pool, mallocator, key_hash, key_compare) cache_type;
+
+    reactor *_reactor;
+    pool *_pool;
+    lookup_type _lookup;
+    timeval _positive_ttl;
+    timeval _negative_ttl;
+    cache_type _cache;
+    ll_list(entry, _expiry) _expiry;
+    unsigned _max_entries;
+    unsigned _calling;
+    int _efd;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    ll_list(request, _entry) _requests;
+    ll_list(request, _entry) _completions;
+    bool _stop;
+
+    void run();
+    int event_handler(file_io&, int type);
+    void complete(entry *e);
+    void submit(entry *e);
+    void evict(entry *e);
+    void evict_expired(timeval now);
+    int do_resolve(const char *host, const char *port, int family, closure_type *c);
+public:
+    resolver(reactor *reactor, pool *pool = nullptr, lookup_type lookup = nullptr) noexcept;
+    ~resolver() noexcept;
+
+    int start();
+    void stop();
+
+    void set_lookup(lookup_type lookup) {
+        _lookup = lookup ? lookup : default_lookup;
+    }
+
+    timeval get_positive_ttl() {
+        return _positive_ttl;
+    }
+
+    timeval get_negative_ttl() {
+        return _negative_ttl;
+    }
+
+    void set_ttl(timeval positive, timeval negative) {
+        _positive_ttl = time_prec_msec::adjust(positive);
+        _negative_ttl = time_prec_msec::adjust(negative);
+    }
+
+    /* at most n names are cached, the oldest results go first. names
+     * with a lookup in flight are kept and may go over */
+    void set_max_entries(unsigned n) {
+        _max_entries = n ? n : default_max_entries;
+    }
+
+    unsigned cached_count() {
+        return _cache.count();
+    }
+
+    /* forget cached results, lookups in flight still complete */
+    void flush_cache();
+
+    /* f(resolver&, rc, addrs, count) runs from the reactor, or right away
+     * on a cache hit. family is AF_UNSPEC, AF_INET or AF_INET6. */
+    template <typename _F, typename ..._Args>
+    int resolve(const char *host, const char *port, int family, _F &&f, _Args&&...args) {
+        return do_resolve(host, port, family, 
+            _new<closure_type>(nullptr, std::forward<_F>(f), std::forward<_Args>(args)...));
+    }
+
+    template <typename _F, typename ..._Args>
+    int resolve(hostinfo *info, _F &&f, _Args&&...args) {
+        return resolve(info->get_host(), info->get_port(), AF_UNSPEC, std::forward<_F>(f), std::forward<_Args>(args)...);
+    }
+};
+
+}
+
+#endif
+
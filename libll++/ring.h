@@ -0,0 +1,292 @@
+#ifndef __LIBLLPP_RING_H__
+#define __LIBLLPP_RING_H__
+
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+
+#include "etc.h"
+#include "construct.h"
+#include "list.h"
+
+namespace ll {
+
+namespace ring_helper { // begin namespace ring_helper
+    inline size_t capacity(size_t n) noexcept {
+        size_t capacity = 2;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    template <typename _T>
+    struct slot {
+        typename std::aligned_storage<sizeof(_T), alignof(_T)>::type _data;
+
+        _T *get() noexcept {
+            return reinterpret_cast<_T*>(&_data);
+        }
+    };
+} // end namespace ring_helper
+
+/* bounded single producer single consumer queue. each side keeps a copy of the
+ * other's index and reloads it only when the ring looks full or empty, so in
+ * the steady state neither touches the other's cache line. */
+template <typename _T>
+class spsc_ring {
+public:
+    typedef _T type_t;
+
+private:
+    typedef ring_helper::slot<_T> slot;
+
+    /* consumer */
+    alignas(ll_cacheline_size) std::atomic<size_t> _head;
+    size_t _tail_cache;
+
+    /* producer */
+    alignas(ll_cacheline_size) std::atomic<size_t> _tail;
+    size_t _head_cache;
+
+    /* read only */
+    alignas(ll_cacheline_size) size_t _mask;
+    slot *_slots;
+
+public:
+    /* rounded up to a power of 2 */
+    spsc_ring(size_t capacity) noexcept :
+        _head(0), _tail_cache(0), _tail(0), _head_cache(0),
+        _mask(ring_helper::capacity(capacity) - 1),
+        _slots((slot*)std::malloc(sizeof(slot) * (_mask + 1))) {}
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring &operator=(const spsc_ring&) = delete;
+
+    ~spsc_ring() noexcept {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        for (; head != tail; head++) {
+            destroy<_T>(_slots[head & _mask].get());
+        }
+        std::free(_slots);
+    }
+
+    size_t capacity() const noexcept {
+        return _mask + 1;
+    }
+
+    /* producer, false if full */
+    template <typename ..._Args>
+    bool push(_Args&&...args) noexcept {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head_cache > _mask) {
+            _head_cache = _head.load(std::memory_order_acquire);
+            if (tail - _head_cache > _mask) {
+                return false;
+            }
+        }
+        construct<_T>(_slots[tail & _mask].get(), std::forward<_Args>(args)...);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* consumer, false if empty */
+    bool pop(_T &value) noexcept {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail_cache) {
+            _tail_cache = _tail.load(std::memory_order_acquire);
+            if (head == _tail_cache) {
+                return false;
+            }
+        }
+        _T *p = _slots[head & _mask].get();
+        value = std::move(*p);
+        destroy<_T>(p);
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* exact from either side when the other is idle */
+    size_t size() const noexcept {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const noexcept {
+        return !size();
+    }
+};
+
+/* bounded multi producer multi consumer queue (vyukov). every slot carries a
+ * sequence telling which lap may write or read it next, producers and consumers
+ * claim a position with one cas and never wait on each other except when the
+ * ring is full or empty. */
+template <typename _T>
+class mpmc_ring {
+public:
+    typedef _T type_t;
+
+private:
+    struct cell : ring_helper::slot<_T> {
+        std::atomic<size_t> _seq;
+    };
+
+    alignas(ll_cacheline_size) std::atomic<size_t> _enqueue_pos;
+    alignas(ll_cacheline_size) std::atomic<size_t> _dequeue_pos;
+    alignas(ll_cacheline_size) size_t _mask;
+    cell *_cells;
+
+public:
+    /* rounded up to a power of 2 */
+    mpmc_ring(size_t capacity) noexcept :
+        _enqueue_pos(0), _dequeue_pos(0),
+        _mask(ring_helper::capacity(capacity) - 1),
+        _cells((cell*)std::malloc(sizeof(cell) * (_mask + 1)))
+    {
+        for (size_t i = 0; i <= _mask; i++) {
+            new (&_cells[i]._seq) std::atomic<size_t>(i);
+        }
+    }
+
+    mpmc_ring(const mpmc_ring&) = delete;
+    mpmc_ring &operator=(const mpmc_ring&) = delete;
+
+    /* no thread may still be inside the ring */
+    ~mpmc_ring() noexcept {
+        size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+        size_t end = _enqueue_pos.load(std::memory_order_relaxed);
+        for (; pos != end; pos++) {
+            destroy<_T>(_cells[pos & _mask].get());
+        }
+        std::free(_cells);
+    }
+
+    size_t capacity() const noexcept {
+        return _mask + 1;
+    }
+
+    /* any thread, false if full */
+    template <typename ..._Args>
+    bool push(_Args&&...args) noexcept {
+        size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        cell *c;
+        for (;;) {
+            c = &_cells[pos & _mask];
+            intptr_t diff = (intptr_t)c->_seq.load(std::memory_order_acquire) - (intptr_t)pos;
+            if (!diff) {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        construct<_T>(c->get(), std::forward<_Args>(args)...);
+        c->_seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* any thread, false if empty */
+    bool pop(_T &value) noexcept {
+        size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+        cell *c;
+        for (;;) {
+            c = &_cells[pos & _mask];
+            intptr_t diff = (intptr_t)c->_seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+            if (!diff) {
+                if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = _dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        _T *p = c->get();
+        value = std::move(*p);
+        destroy<_T>(p);
+        c->_seq.store(pos + _mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* a snapshot, may be stale by the time it returns */
+    size_t size() const noexcept {
+        size_t tail = _enqueue_pos.load(std::memory_order_acquire);
+        size_t head = _dequeue_pos.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const noexcept {
+        return !size();
+    }
+};
+
+/* intrusive lock free stack over an slist_entry field. any thread pushes, one
+ * consumer pops or takes everything at once. a single consumer is what keeps
+ * pop free of aba: a popped element cannot come back while it is being read. */
+template <typename _T, typename _Entry, _Entry _T::*__field, typename _U = _T>
+class mpsc_stack {
+    static_assert(_Entry::type == list_type::slist, "mpsc_stack needs an slist_entry.");
+public:
+    typedef _T type;
+    typedef _U value_type;
+    typedef _Entry entry_type;
+    typedef list<_T, _Entry, __field, _U> list_t;
+
+private:
+    alignas(ll_cacheline_size) std::atomic<type*> _head;
+
+    static entry_type &entry(type *elm) noexcept {
+        return static_cast<entry_type&>(elm->*__field);
+    }
+
+public:
+    mpsc_stack() noexcept : _head(nullptr) {}
+    mpsc_stack(const mpsc_stack&) = delete;
+    mpsc_stack &operator=(const mpsc_stack&) = delete;
+
+    /* any thread, true if the stack was empty */
+    bool push(type *elm) noexcept {
+        type *head = _head.load(std::memory_order_relaxed);
+        do {
+            entry(elm)._next = head;
+        } while (!_head.compare_exchange_weak(head, elm, std::memory_order_release, std::memory_order_relaxed));
+        return !head;
+    }
+
+    /* consumer, the newest element */
+    value_type *pop() noexcept {
+        type *head = _head.load(std::memory_order_acquire);
+        while (head && !_head.compare_exchange_weak(head, static_cast<type*>(entry(head)._next),
+                                                    std::memory_order_acquire, std::memory_order_acquire));
+        return static_cast<value_type*>(head);
+    }
+
+    /* consumer, everything pushed so far, oldest first */
+    list_t take_all() noexcept {
+        list_t l;
+        type *elm = _head.exchange(nullptr, std::memory_order_acquire);
+        while (elm) {
+            type *next = static_cast<type*>(entry(elm)._next);
+            l.push_front(elm);
+            elm = next;
+        }
+        return l;
+    }
+
+    bool empty() const noexcept {
+        return !_head.load(std::memory_order_relaxed);
+    }
+};
+
+}
+
+#endif
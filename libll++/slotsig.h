@@ -7,6 +7,73 @@
 
 namespace ll {
 
+/* emission state of a slot list, lets a slot connect and disconnect from inside
+ * an emit. a slot connected during an emission is first called by the next one
+ * that starts. a slot disconnected during an emission is marked dead and stays
+ * linked, so iteration never loses its place, and is unlinked when the
+ * outermost emission ends. */
+namespace slotsig_helper { // begin namespace slotsig_helper
+    struct mark {
+        unsigned _generation;       /* 0, or the generation it was connected in */
+        bool _dead;
+
+        mark() noexcept : _generation(), _dead() {}
+    };
+
+    struct state {
+        unsigned _depth;
+        unsigned _generation;       /* counts emissions inside the outermost one */
+        bool _dirty;                /* some slot needs a sweep */
+
+        state() noexcept : _depth(), _generation(), _dirty() {}
+
+        void connected(mark &m) noexcept {
+            m._generation = _generation;
+            m._dead = false;
+            if (_depth) {
+                _dirty = true;
+            }
+        }
+
+        /* false if the unlink must wait for the emission to end */
+        bool disconnect(mark &m) noexcept {
+            if (!_depth) {
+                return true;
+            }
+            m._dead = true;
+            _dirty = true;
+            return false;
+        }
+    };
+
+    template <typename _Signal>
+    class scope {
+    private:
+        _Signal *_signal;
+        unsigned _generation;
+    public:
+        scope(_Signal *signal) noexcept : _signal(signal) {
+            _signal->_state._depth++;
+            _generation = ++_signal->_state._generation;
+        }
+
+        ~scope() noexcept {
+            state &st = _signal->_state;
+            if (!--st._depth) {
+                st._generation = 0;
+                if (st._dirty) {
+                    st._dirty = false;
+                    _signal->sweep();
+                }
+            }
+        }
+
+        bool callable(const mark &m) const noexcept {
+            return !m._dead && m._generation < _generation;
+        }
+    };
+} // end namespace slotsig_helper
+
 template <typename signature, bool __once = false, typename _Allocator = allocator>
 class signal;
 
@@ -24,6 +91,7 @@ public:
         friend class signal;
         clist_entry _entry;
         closure_type *_closure;
+        slotsig_helper::mark _mark;
     public:
         slot() : _entry(nullptr) {}
     };
@@ -39,6 +107,23 @@ private:
     };
 
     impl _impl;
+    slotsig_helper::state _state;
+
+    friend class slotsig_helper::scope<signal>;
+
+    void sweep() noexcept {
+        auto end = _impl._list.end();
+        for (auto it = _impl._list.begin(); it != end;) {
+            slot *s = it.pointer();
+            ++it;
+            if (s->_mark._dead) {
+                disconnect(s);
+            }
+            else {
+                s->_mark._generation = 0;
+            }
+        }
+    }
 public:
     signal() noexcept : _impl() {}
     signal(const allocator_type &a) noexcept : _impl(a) {}
@@ -51,6 +136,7 @@ public:
     slot *connect(_T &&obj, _Params&&...args) noexcept {
         slot *s = _new<slot>(_impl);
         s->_closure = _new<closure_type>(_impl, std::forward<_T>(obj), std::forward<_Params>(args)...);
+        _state.connected(s->_mark);
         _impl._list.push_back(s);
         return s;
     }
@@ -59,13 +145,22 @@ public:
         return !_impl._list.empty();
     }
 
+    /* safe from inside an emit, the slot is not called again */
     void disconnect(slot *s) noexcept {
-        _impl._list.remove(s);
-        _delete<closure_type>(_impl, s->_closure);
-        _delete<slot>(_impl, s);
+        if (_state.disconnect(s->_mark)) {
+            _impl._list.remove(s);
+            _delete<closure_type>(_impl, s->_closure);
+            _delete<slot>(_impl, s);
+        }
     }
 
     void disconnect_all() noexcept {
+        if (_state._depth) {
+            for (auto it = _impl._list.begin(); it != _impl._list.end(); ++it) {
+                disconnect(it.pointer());
+            }
+            return;
+        }
         slot *s;
         while ((s = _impl._list.front())) {
             disconnect(s);
@@ -78,8 +173,12 @@ public:
             std::is_void<_Ret>::value, _Ret
         >::type
     emit(_Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _impl._list.end();
         for (auto it = _impl._list.begin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             it.pointer()->_closure->apply(std::forward<_Args>(args)...);
         }
     }
@@ -89,10 +188,14 @@ public:
             std::is_void<_Ret>::value, _R
         >::type
     emit_and_disconnect(_Args...args) {
-        slot *s;
-        while ((s = _impl._list.front())) {
-            s->_closure->apply(std::forward<_Args>(args)...);
-            disconnect(s);
+        slotsig_helper::scope<signal> scope(this);
+        auto end = _impl._list.end();
+        for (auto it = _impl._list.begin(); it != end; ++it) {
+            slot *s = it.pointer();
+            if (scope.callable(s->_mark)) {
+                s->_closure->apply(std::forward<_Args>(args)...);
+                disconnect(s);
+            }
         }
     }
 
@@ -103,8 +206,12 @@ public:
             _Ret
         >::type
     emit(_F f, _Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _impl._list.end();
         for (auto it = _impl._list.begin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             if (!f(it.pointer()->_closure->apply(std::forward<_Args>(args)...))) {
                 return false;
             }
@@ -118,8 +225,12 @@ public:
             _Ret
         >::type
     emit(_Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _impl._list.end();
         for (auto it = _impl._list.begin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             it.pointer()->_closure->apply(std::forward<_Args>(args)...);
         }
         return true;
@@ -134,8 +245,12 @@ public:
         >::type
     emit(_F f, _Args...args) {
         _Ret n;
+        slotsig_helper::scope<signal> scope(this);
         auto end = _impl._list.end();
         for (auto it = _impl._list.begin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             if ((n = f(it.pointer()->_closure->apply(std::forward<_Args>(args)...)))) {
                 return n;
             }
@@ -159,8 +274,12 @@ public:
             std::is_void<_Ret>::value, _Ret
         >::type
     remit(_Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _impl._list.rend();
         for (auto it = _impl._list.rbegin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             it.pointer()->_closure->apply(std::forward<_Args>(args)...);
         }
     }
@@ -172,8 +291,12 @@ public:
             _Ret
         >::type
     remit(_F f, _Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _impl._list.rend();
         for (auto it = _impl._list.rbegin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             if (!f(it.pointer()->_closure->apply(std::forward<_Args>(args)...))) {
                 return false;
             }
@@ -187,8 +310,12 @@ public:
             _Ret
         >::type
     remit(_Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _impl._list.rend();
         for (auto it = _impl._list.rbegin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             it.pointer()->_closure->apply(std::forward<_Args>(args)...);
         }
         return true;
@@ -203,8 +330,12 @@ public:
         >::type
     remit(_F f, _Args...args) {
         _Ret n;
+        slotsig_helper::scope<signal> scope(this);
         auto end = _impl._list.rend();
         for (auto it = _impl._list.rbegin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             if ((n = f(it.pointer()->_closure->apply(std::forward<_Args>(args)...)))) {
                 return n;
             }
@@ -237,6 +368,7 @@ public:
         friend class signal;
         clist_entry _entry;
         closure_type *_closure;
+        slotsig_helper::mark _mark;
 
     public:
         closure_type *get_closure() {
@@ -253,6 +385,23 @@ public:
 
 private:
     ll_list(slot, _entry) _list;
+    slotsig_helper::state _state;
+
+    friend class slotsig_helper::scope<signal>;
+
+    void sweep() noexcept {
+        auto end = _list.end();
+        for (auto it = _list.begin(); it != end;) {
+            slot *s = it.pointer();
+            ++it;
+            if (s->_mark._dead) {
+                _list.remove(s);
+            }
+            else {
+                s->_mark._generation = 0;
+            }
+        }
+    }
 
 public:
     signal() noexcept : _list() {}
@@ -261,6 +410,7 @@ public:
     }
 
     slot *connect(slot *s) noexcept {
+        _state.connected(s->_mark);
         _list.push_back(s);
         return s;
     }
@@ -269,11 +419,21 @@ public:
         return !_list.empty();
     }
 
+    /* safe from inside an emit, the slot is not called again. it stays
+     * linked until the emission ends, the owner must not free it before */
     void disconnect(slot *s) noexcept {
-        _list.remove(s);
+        if (_state.disconnect(s->_mark)) {
+            _list.remove(s);
+        }
     }
 
     void disconnect_all() noexcept {
+        if (_state._depth) {
+            for (auto it = _list.begin(); it != _list.end(); ++it) {
+                disconnect(it.pointer());
+            }
+            return;
+        }
         _list.init();
     }
 
@@ -281,8 +441,12 @@ public:
     template <typename _Ret = _R>
     typename std::enable_if<std::is_void<_Ret>::value, _Ret>::type
     emit(_Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _list.end();
         for (auto it = _list.begin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             it.pointer()->_closure->apply(std::forward<_Args>(args)...);
         }
     }
@@ -293,8 +457,12 @@ public:
         std::is_same<typename std::remove_cv<_Ret>::type, bool>::value, 
         _Ret>::type
     emit(_F f, _Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _list.end();
         for (auto it = _list.begin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             if (!f(it.pointer()->_closure->apply(std::forward<_Args>(args)...))) {
                 return false;
             }
@@ -307,8 +475,12 @@ public:
         std::is_same<typename std::remove_cv<_Ret>::type, bool>::value, 
         _Ret>::type
     emit(_Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _list.end();
         for (auto it = _list.begin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             it.pointer()->_closure->apply(std::forward<_Args>(args)...);
         }
         return true;
@@ -321,8 +493,12 @@ public:
         !std::is_void<_Ret>::value, _Ret>::type
     emit(_F f, _Args...args) {
         _Ret n;
+        slotsig_helper::scope<signal> scope(this);
         auto end = _list.end();
         for (auto it = _list.begin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             if ((n = f(it.pointer()->_closure->apply(std::forward<_Args>(args)...)))) {
                 return n;
             }
@@ -342,8 +518,12 @@ public:
     template <typename _Ret = _R>
     typename std::enable_if<std::is_void<_Ret>::value, _Ret>::type
     remit(_Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _list.rend();
         for (auto it = _list.rbegin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             it.pointer()->_closure->apply(std::forward<_Args>(args)...);
         }
     }
@@ -354,8 +534,12 @@ public:
         std::is_same<typename std::remove_cv<_Ret>::type, bool>::value, 
         _Ret>::type
     remit(_F f, _Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _list.rend();
         for (auto it = _list.rbegin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             if (!f(it.pointer()->_closure->apply(std::forward<_Args>(args)...))) {
                 return false;
             }
@@ -368,8 +552,12 @@ public:
         std::is_same<typename std::remove_cv<_Ret>::type, bool>::value, 
         _Ret>::type
     remit(_Args...args) {
+        slotsig_helper::scope<signal> scope(this);
         auto end = _list.rend();
         for (auto it = _list.rbegin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             it.pointer()->_closure->apply(std::forward<_Args>(args)...);
         }
         return true;
@@ -382,8 +570,12 @@ public:
         !std::is_void<_Ret>::value, _Ret>::type
     remit(_F f, _Args...args) {
         _Ret n;
+        slotsig_helper::scope<signal> scope(this);
         auto end = _list.rend();
         for (auto it = _list.rbegin(); it != end; ++it) {
+            if (!scope.callable(it.pointer()->_mark)) {
+                continue;
+            }
             if ((n = f(it.pointer()->_closure->apply(std::forward<_Args>(args)...)))) {
                 return n;
             }
@@ -413,12 +605,13 @@ public:
 private:
     typedef _Allocator allocator_type;
 
+    /* the closure lives in the signal, connecting a small functor allocates nothing */
     struct impl : public allocator_type {
         impl() noexcept : allocator_type(), _closure() {}
         impl(const allocator_type &a) noexcept : allocator_type(a), _closure() {}
         impl(allocator_type &&a) noexcept : allocator_type(std::move(a)), _closure() {}
 
-        closure_type *_closure;
+        inline_closure<signature> _closure;
     };
 
     impl _impl;
@@ -432,26 +625,22 @@ public:
 
     template <typename _T, typename ..._Params>
     void connect(_T &&obj, _Params&&...args) noexcept {
-        disconnect();
-        _impl._closure = _new<closure_type>(_impl, std::forward<_T>(obj), std::forward<_Params>(args)...);
+        _impl._closure.set(_impl, std::forward<_T>(obj), std::forward<_Params>(args)...);
     }
 
     bool connected() noexcept {
-        return _impl._closure != nullptr;
+        return (bool)_impl._closure;
     }
 
     void disconnect() noexcept {
-        if (_impl._closure) {
-            _delete<closure_type>(_impl, _impl._closure);
-            _impl._closure = nullptr;
-        }
+        _impl._closure.reset(_impl);
     }
 
     /* emit result is void */
     template <typename _Ret = _R>
     typename std::enable_if<std::is_void<_Ret>::value, _Ret>::type
     emit(_Args...args) {
-        closure_type *c = _impl._closure;
+        closure_type *c = _impl._closure.get();
         if (c) {
             c->apply(std::forward<_Args>(args)...);
         }
@@ -463,7 +652,7 @@ public:
         std::is_same<typename std::remove_cv<_Ret>::type, bool>::value, 
         _Ret>::type
     emit(_Args...args) {
-        closure_type *c = _impl._closure;
+        closure_type *c = _impl._closure.get();
         if (c) {
             return c->apply(std::forward<_Args>(args)...);
         }
@@ -476,7 +665,7 @@ public:
         !std::is_same<typename std::remove_cv<_Ret>::type, bool>::value && 
         !std::is_void<_Ret>::value, _Ret>::type
     emit(_Args...args) {
-        closure_type *c = _impl._closure;
+        closure_type *c = _impl._closure.get();
         if (c) {
             return c->apply(std::forward<_Args>(args)...);
         }
@@ -547,5 +736,65 @@ public:
     }
 };
 
+/* statically bound once signal, the handler type is part of the signal and
+ * emit is a direct call the compiler can inline. the handler is fixed at
+ * construction, there is nothing to connect or disconnect. */
+template <typename _Sig, typename _Handler>
+class delegate;
+
+template <typename _Handler, typename _R, typename ..._Args>
+class delegate<_R(_Args...), _Handler> {
+public:
+    typedef _R signature(_Args...);
+    typedef _Handler handler_type;
+
+private:
+    _Handler _handler;
+public:
+    delegate() noexcept : _handler() {}
+    delegate(const _Handler &handler) noexcept : _handler(handler) {}
+    delegate(_Handler &&handler) noexcept : _handler(std::move(handler)) {}
+
+    handler_type &get_handler() noexcept {
+        return _handler;
+    }
+
+    bool connected() noexcept {
+        return true;
+    }
+
+    _R emit(_Args...args) {
+        return _handler(std::forward<_Args>(args)...);
+    }
+
+    _R operator()(_Args...args) {
+        return _handler(std::forward<_Args>(args)...);
+    }
+};
+
+template <typename _Sig, typename _Handler>
+inline delegate<_Sig, typename std::decay<_Handler>::type> make_delegate(_Handler &&handler) {
+    return delegate<_Sig, typename std::decay<_Handler>::type>(std::forward<_Handler>(handler));
+}
+
+/* a member function bound at compile time, the delegate handler for a method.
+ * ll_member_handler(&foo::bar) names the type. */
+template <typename _MemFn, _MemFn __fn>
+class member_handler;
+
+template <typename _T, typename _R, typename ..._Args, _R (_T::*__fn)(_Args...)>
+class member_handler<_R (_T::*)(_Args...), __fn> {
+private:
+    _T *_obj;
+public:
+    member_handler(_T *obj) noexcept : _obj(obj) {}
+
+    _R operator()(_Args...args) {
+        return (_obj->*__fn)(std::forward<_Args>(args)...);
+    }
+};
+
+#define ll_member_handler(fn) ll::member_handler<decltype(fn), fn>
+
 }
 #endif
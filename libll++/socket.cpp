@@ -2,6 +2,7 @@
 #include <cstdlib>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include "memory.h"
 #include "socket.h"
@@ -18,6 +19,13 @@ int hostinfo::init(const char *uri, pool *pool) noexcept
     const char *rsb;
     int v6_offset1 = 0;
 
+    /* unix:<path> has no port */
+    if (!strncmp(uri, address::unix_prefix, strlen(address::unix_prefix))) {
+        _host = pool->strdup(uri);
+        _port = nullptr;
+        return ok;
+    }
+
     /* We expect hostinfo to point to the first character of
      * the hostname.  There must be a port, separated by a colon
      */
@@ -62,6 +70,10 @@ int address::resolve(const char *host, const char *port)
         host = nullptr;
     }
 
+    if (host && !strncmp(host, unix_prefix, strlen(unix_prefix))) {
+        return set_unix(host + strlen(unix_prefix));
+    }
+
     memset(&hints, 0, sizeof(struct ::addrinfo));
     hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = 0;
@@ -77,12 +89,91 @@ int address::resolve(const char *host, const char *port)
         return fail;
     }
 
-    memcpy(&_addr, ai->ai_addr, sizeof(struct sockaddr_in));
+    error = assign(ai->ai_addr, ai->ai_addrlen);
     freeaddrinfo(ai);
 
+    return error;
+}
+
+int address::assign(const struct sockaddr *sa, unsigned len)
+{
+    switch (sa->sa_family) {
+    case AF_INET:
+        if (len < sizeof(sockaddr_in)) {
+            return e_inval;
+        }
+        len = sizeof(sockaddr_in);
+        break;
+    case AF_INET6:
+        if (len < sizeof(sockaddr_in6)) {
+            return e_inval;
+        }
+        len = sizeof(sockaddr_in6);
+        break;
+    case AF_UNIX:
+        if (len < offsetof(struct sockaddr_un, sun_path) || len > sizeof(sockaddr_un)) {
+            return e_inval;
+        }
+        break;
+    default:
+        return e_inval;
+    }
+
+    memset(&_ss, 0, sizeof(_ss));
+    memcpy(&_ss, sa, len);
+    _len = len;
+    return ok;
+}
+
+int address::set_unix(const char *path)
+{
+    size_t n = strlen(path);
+    bool abstract = *path == '@';
+
+    /* abstract names are not nul terminated and may fill sun_path, 
+       a filesystem path needs room for its nul */
+    if (!n || n > sizeof(_sun.sun_path) || (!abstract && n == sizeof(_sun.sun_path))) {
+        return e_inval;
+    }
+
+    memset(&_ss, 0, sizeof(_ss));
+    _sun.sun_family = AF_UNIX;
+    memcpy(_sun.sun_path, path, n);
+
+    if (abstract) {
+        /* the length delimits the name, the leading '@' becomes the nul */
+        _sun.sun_path[0] = '\0';
+        _len = offsetof(struct sockaddr_un, sun_path) + n;
+    }
+    else {
+        _len = offsetof(struct sockaddr_un, sun_path) + n + 1;
+    }
     return ok;
 }
 
+const char *address::get_host()
+{
+    static __thread char buf[sizeof(sockaddr_un)];
+
+    switch (_sa.sa_family) {
+    case AF_INET:
+        return inet_ntop(AF_INET, &_sin.sin_addr, buf, sizeof(buf));
+    case AF_INET6:
+        return inet_ntop(AF_INET6, &_sin6.sin6_addr, buf, sizeof(buf));
+    case AF_UNIX: {
+        size_t n = _len > offsetof(struct sockaddr_un, sun_path) ? _len - offsetof(struct sockaddr_un, sun_path) : 0;
+        memcpy(buf, _sun.sun_path, n);
+        if (n && !buf[0]) {
+            buf[0] = '@';
+        }
+        buf[n] = '\0';
+        return buf;
+    }
+    default:
+        return nullptr;
+    }
+}
+
 /* connector */
 connector::connector(address &addr, reactor *reactor, timer_manager *timermgr, 
                      timeval timeout, timeval interval) 
@@ -184,6 +275,8 @@ again:
         case EINTR:
             goto again;
         case ECONNREFUSED: 
+        case EAGAIN:
+            /* a unix socket whose backlog is full, retry like a refusal */
             ll_failed_return(do_emit(_fd, reactor::poll_err));
             if (_interval) {
                 _reactor->close(_fd);
@@ -211,7 +304,7 @@ int connector::connect()
     }
 
     _emitting = false;
-    ll_sys_failed_return(_fd = ::socket(AF_INET, SOCK_STREAM, 0));
+    ll_sys_failed_return(_fd = ::socket(_addr.family(), SOCK_STREAM, 0));
 
     if (ll_failed(_reactor->open(_fd, reactor::poll_out | reactor::poll_err, &connector::connect_handler, this))) {
         _fd.close();
@@ -266,39 +359,9 @@ inline int listener::do_emit(int fd, int flags, address &addr)
 
 int listener::accept_handler(file_io&, int type)
 {
-    if (type & reactor::poll_close) {
-        do_emit(_fd, reactor::poll_close, _addr);
-        close();
-        return -1;
-    }
-
-    if (type & reactor::poll_err) {
-        do_emit(_fd, reactor::poll_err, _addr);
-        return -1;
-    }
-
-    if (type & reactor::poll_in) {
-        address addr;
-        while (1) {
-            socklen_t len = address::length();
-            int fd = ::accept(_fd, addr, &len);
-    
-            if (fd < 0) {
-                switch (errno) {
-                case EAGAIN:
-                    return ok;
-                case EINTR:
-                    continue;
-                default:
-                    do_emit(_fd, reactor::poll_err, _addr);
-                    return -1;
-                }
-            }
-
-            ll_failed_return(do_emit(fd, reactor::poll_in, addr));
-        }
-    }
-    return ok;
+    return accept_all(type, [this](int fd, int flags, address &addr) {
+        return do_emit(fd, flags, addr);
+    });
 }
 
 int listener::listen()
@@ -307,11 +370,19 @@ int listener::listen()
         return e_busy;
     }
 
-    ll_sys_failed_return(_fd = ::socket(AF_INET, SOCK_STREAM, 0));
+    ll_sys_failed_return(_fd = ::socket(_addr.family(), SOCK_STREAM, 0));
 
     auto guard = make_guard([this](){ _fd.close(); });
-    int n = 1;
-    ll_sys_failed_return(::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &n, sizeof(int)));
+    if (_addr.is_unix()) {
+        /* a stale socket file from a previous run would make bind fail */
+        if (!_addr.is_abstract()) {
+            ::unlink(((struct sockaddr_un*)_addr)->sun_path);
+        }
+    }
+    else {
+        int n = 1;
+        ll_sys_failed_return(::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &n, sizeof(int)));
+    }
     ll_sys_failed_return(::bind(_fd, _addr, _addr.length()));
     ll_sys_failed_return(::listen(_fd, _backlog));
     ll_failed_return(_reactor->open(_fd, reactor::poll_in | reactor::poll_err, &listener::accept_handler, this));
@@ -329,6 +400,9 @@ void listener::close()
     if (!_emitting) {
         if (_fd.opened()) {
             _reactor->close(_fd);
+            if (_addr.is_unix() && !_addr.is_abstract()) {
+                ::unlink(((struct sockaddr_un*)_addr)->sun_path);
+            }
         }
     }
 }
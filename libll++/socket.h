@@ -1,8 +1,13 @@
 #ifndef __LIBLLPP_SOCKET_H__
 #define __LIBLLPP_SOCKET_H__
 
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -32,47 +37,112 @@ public:
     }
 
     unsigned get_portn() {
-        return strtoul(_port, nullptr, 10);
+        return _port ? strtoul(_port, nullptr, 10) : 0;
     }
 
 };
 
 class address {
+public:
+    static constexpr const char *unix_prefix = "unix:";
+
 protected:
-    struct sockaddr_in _addr;
+    union {
+        struct sockaddr _sa;
+        struct sockaddr_in _sin;
+        struct sockaddr_in6 _sin6;
+        struct sockaddr_un _sun;
+        struct sockaddr_storage _ss;
+    };
+    unsigned _len;
 
 public:
-    static constexpr unsigned length() {
-        return sizeof(sockaddr_in);
+    address() noexcept : _len() {
+        memset(&_ss, 0, sizeof(_ss));
+    }
+
+    static constexpr unsigned max_length() {
+        return sizeof(sockaddr_storage);
+    }
+
+    unsigned length() const {
+        return _len;
+    }
+
+    /* after accept()/recvfrom() filled the storage */
+    void set_length(unsigned len) {
+        assert(len <= max_length());
+        _len = len;
+    }
+
+    int family() const {
+        return _sa.sa_family;
+    }
+
+    bool is_unix() const {
+        return _sa.sa_family == AF_UNIX;
+    }
+
+    /* a unix socket living in the linux abstract namespace, no file on disk */
+    bool is_abstract() const {
+        return is_unix() && _len > offsetof(struct sockaddr_un, sun_path) && !_sun.sun_path[0];
     }
 
-    operator const struct sockaddr*() {
-        return (struct sockaddr*)&_addr;
+    operator const struct sockaddr*() const {
+        return &_sa;
     }
 
     operator struct sockaddr*() {
-        return (struct sockaddr*)&_addr;
+        return &_sa;
     }
 
-    operator const struct sockaddr_in*() {
-        return &_addr;
+    operator const struct sockaddr_in*() const {
+        return &_sin;
     }
 
     operator struct sockaddr_in*() {
-        return &_addr;
+        return &_sin;
+    }
+
+    operator const struct sockaddr_in6*() const {
+        return &_sin6;
+    }
+
+    operator struct sockaddr_in6*() {
+        return &_sin6;
     }
 
+    operator const struct sockaddr_un*() const {
+        return &_sun;
+    }
+
+    operator struct sockaddr_un*() {
+        return &_sun;
+    }
+
+    int assign(const struct sockaddr *sa, unsigned len);
+
+    /* path is a filesystem path, or an abstract name when it starts with '@' */
+    int set_unix(const char *path);
+
+    /* blocking, use resolver on a reactor thread. host "unix:<path>" 
+     * selects a unix socket and ignores port. */
     int resolve(const char *host, const char *port);
     int resolve(hostinfo *info) {
         return resolve(info->get_host(), info->get_port());
     }
 
-    const char *get_host() {
-        return inet_ntoa(_addr.sin_addr);
-    }
+    const char *get_host();
 
     unsigned get_port() {
-        return ntohs(_addr.sin_port);
+        switch (_sa.sa_family) {
+        case AF_INET:
+            return ntohs(_sin.sin_port);
+        case AF_INET6:
+            return ntohs(_sin6.sin6_port);
+        default:
+            return 0;
+        }
     }
 };
 
@@ -241,9 +311,55 @@ public:
         return _fd.opened();
     }
 
+    int get_fd() {
+        return _fd;
+    }
+
     void close();
     int listen();
 
+    /* the reactor reported type on the listening fd, accepts the whole backlog
+     * and calls handler(fd, flags, addr) for each connection. a handler given
+     * here is called directly, e.g. from reactor::loop(tv, handler), and
+     * bypasses the signal. */
+    template <typename _Handler>
+    int accept_all(int type, _Handler &&handler) {
+        if (type & reactor::poll_close) {
+            handler((int)_fd, reactor::poll_close, _addr);
+            close();
+            return -1;
+        }
+
+        if (type & reactor::poll_err) {
+            handler((int)_fd, reactor::poll_err, _addr);
+            return -1;
+        }
+
+        if (type & reactor::poll_in) {
+            address addr;
+            while (1) {
+                socklen_t len = address::max_length();
+                int fd = ::accept(_fd, addr, &len);
+
+                if (fd < 0) {
+                    switch (errno) {
+                    case EAGAIN:
+                        return ok;
+                    case EINTR:
+                        continue;
+                    default:
+                        handler((int)_fd, reactor::poll_err, _addr);
+                        return -1;
+                    }
+                }
+
+                addr.set_length(len);
+                ll_failed_return(handler(fd, reactor::poll_in, addr));
+            }
+        }
+        return ok;
+    }
+
     template <typename _F, typename ..._Args>
     int listen(_F &&f, _Args&&...args) {
         connect(std::forward<_F>(f), std::forward<_Args>(args)...);
@@ -15,7 +15,7 @@ struct input {
     size_t _size;
 
     input() noexcept : _first_chunk(), _firstp(), _size() {}
-    input(const input_struct &x) noexcept : 
+    input(const input &x) noexcept : 
         _first_chunk(x._first_chunk),
         _firstp(x._firstp),
         _size(x._size) {}
@@ -24,20 +24,27 @@ struct input {
         _first_chunk(x._first_chunk),
         _firstp(x._firstp),
         _size(size) {
-        assert(size && x._size >= size);
+        assert(x._size >= size);
     }
 
-    input(input &&x) : noexcept {
+    input(input &&x) noexcept : input() {
         swap(x);
     }
 
+    input &operator=(const input &x) noexcept {
+        _first_chunk = x._first_chunk;
+        _firstp = x._firstp;
+        _size = x._size;
+        return *this;
+    }
+
     void swap(input &x) {
         std::swap(_first_chunk, x._first_chunk);
         std::swap(_firstp, x._firstp);
         std::swap(_size, x._size);
     }
 
-    void discard(unsigned size) noexcept {
+    void discard(size_t size) noexcept {
         assert(size && _size >= size);
 
         _size -= size;
@@ -68,6 +75,59 @@ struct input {
         }
     }
 
+    /* copy up to size bytes without consuming them, frames may span chunks */
+    size_t peek(void *buf, size_t size) const noexcept {
+        if (size > _size) {
+            size = _size;
+        }
+
+        register char *p = (char*)buf;
+        register page *chunk = _first_chunk;
+        register char *firstp = _firstp;
+        size_t left = size;
+        while (left) {
+            size_t n = chunk->endp - firstp;
+            if (n > left) {
+                n = left;
+            }
+            memcpy(p, firstp, n);
+            p += n;
+            left -= n;
+
+            chunk = chunk->next;
+            firstp = chunk->firstp;
+        }
+        return size;
+    }
+
+    /* offset of the first c at or after offset, -1 if not present */
+    long find(char c, size_t offset = 0) const noexcept {
+        register page *chunk = _first_chunk;
+        register char *firstp = _firstp;
+        size_t pos = 0;
+        size_t left = _size;
+        while (left) {
+            size_t n = chunk->endp - firstp;
+            if (n > left) {
+                n = left;
+            }
+
+            if (offset < pos + n) {
+                size_t skip = offset > pos ? offset - pos : 0;
+                char *p = (char*)memchr(firstp + skip, c, n - skip);
+                if (p) {
+                    return pos + (p - firstp);
+                }
+            }
+
+            pos += n;
+            left -= n;
+            chunk = chunk->next;
+            firstp = chunk->firstp;
+        }
+        return -1;
+    }
+
     static void read(input_struct *data, void *buf, size_t size) noexcept {
         assert(buf && size && _size >= size);
 
@@ -213,6 +273,16 @@ public:
         return _size;
     }
 
+    const stream_helper::input &data() const noexcept {
+        return _data;
+    }
+
+    void discard(size_t size) noexcept {
+        if (size) {
+            _data.discard(size);
+        }
+    }
+
     void clear() {
         page *chunk = _end_chunk->next;
         while (chunk != _end_chunk) {
@@ -37,14 +37,21 @@ void timer_manager::remove(timer *timer) noexcept
     _delete<ll::timer>(timer);
 }
 
+/* an idle timer runs once and is freed, remove() from its own closure is a no-op */
+inline void timer_manager::run_idle() noexcept
+{
+    while ((_cur = _list.pop_front())) {
+        _cur->_idle_closure.apply();
+        _delete<ll::timer>(_cur);
+    }
+}
+
 timeval timer_manager::loop_i(timeval curtime) noexcept
 {
     timer *timer;
     timeval expires;
 
-    while ((_cur = _list.pop_front())) {
-        _cur->_idle_closure->apply();
-    }
+    run_idle();
 
     while (1) {
         timer = _cur = _map.front();
@@ -59,9 +66,7 @@ timeval timer_manager::loop_i(timeval curtime) noexcept
         dispatch(timer, curtime);
     }
 
-    while ((_cur = _list.pop_front())) {
-        _cur->_idle_closure->apply();
-    }
+    run_idle();
 
     return expires;
 }
@@ -71,7 +76,7 @@ inline void timer_manager::dispatch(timer *timer, timeval curtime) noexcept
     _map.remove(timer);
 
     while (1) {
-        timeval d = timer->_timer_closure->apply(*timer, curtime);
+        timeval d = timer->_timer_closure.apply(*timer, curtime);
         if (d <= 0) {
             _delete<ll::timer>(timer);
             return;
@@ -19,9 +19,10 @@ private:
         };
         clist_entry _list_entry;
     };
+    /* in place, a timer with a small functor is a single allocation */
     union {
-        closure<timeval(timer&, timeval)> *_timer_closure;
-        closure<void()> *_idle_closure;
+        inline_closure<timeval(timer&, timeval)> _timer_closure;
+        inline_closure<void()> _idle_closure;
     };
 public:
     static timeval get_key(timer *t) noexcept {
@@ -32,8 +33,8 @@ public:
     static timer *_new(_F &&f, _Args&&...args) {
         timer *t = (timer*)mem_alloc(sizeof(timer));
         t->_is_idle = true;
-        t->_idle_closure = ll::_new<closure<void()>>(
-            nullptr, std::forward<_F>(f), std::forward<_Args>(args)...);
+        construct<inline_closure<void()>>(&t->_idle_closure);
+        t->_idle_closure.set(nullptr, std::forward<_F>(f), std::forward<_Args>(args)...);
         return t;
     }
 
@@ -42,17 +43,17 @@ public:
         timer *t = (timer*)mem_alloc(sizeof(timer));
         t->_is_idle = false;
         t->_expires = expires;
-        t->_timer_closure = ll::_new<closure<timeval(timer&, timeval)>>(
-            nullptr, std::forward<_F>(f), std::forward<_Args>(args)...);
+        construct<inline_closure<timeval(timer&, timeval)>>(&t->_timer_closure);
+        t->_timer_closure.set(nullptr, std::forward<_F>(f), std::forward<_Args>(args)...);
         return t;
     }
 
     static void _delete(timer *t) {
         if (t->_is_idle) {
-            ll::_delete<closure<void()>>(nullptr, t->_idle_closure);
+            t->_idle_closure.reset(nullptr);
         }
         else {
-            ll::_delete<closure<timeval(timer&, timeval)>>(nullptr, t->_timer_closure);
+            t->_timer_closure.reset(nullptr);
         }
         mem_free(t, sizeof(timer));
     }
@@ -65,6 +66,7 @@ private:
     timer *_cur;
 
     void dispatch(timer *timer, timeval curtime) noexcept;
+    void run_idle() noexcept;
     void modify_i(timer *timer, timeval expires) noexcept;
     timeval loop_i(timeval curtime) noexcept;
 
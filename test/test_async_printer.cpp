@@ -0,0 +1,144 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/async_printer.h"
+#include "libll++/timeval.h"
+
+static constexpr unsigned threads = 4;
+static constexpr unsigned lines = 20000;
+
+static ll::timeval run(ll::async_printer *printer)
+{
+    printer->open();
+    ll::log::set_printter(printer);
+
+    ll::time_trace t;
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([i]() {
+            for (unsigned n = 0; n < lines; n++) {
+                ll::info("thread %u line %u\n", i, n);
+            }
+        });
+    }
+    for (auto &th : workers) {
+        th.join();
+    }
+    ll::timeval tv = t.check();
+
+    ll::log::set_printter();
+    return tv;
+}
+
+static unsigned count_lines(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    unsigned n = 0;
+    int c;
+    while ((c = fgetc(fp)) != EOF) {
+        if (c == '\n') {
+            n++;
+        }
+    }
+    fclose(fp);
+    return n;
+}
+
+/* every line of the file came from printer name, in order for each thread */
+static bool check_order(const char *path, char name, unsigned *count)
+{
+    FILE *fp = fopen(path, "r");
+    std::vector<int> last(threads, -1);
+    char buf[64];
+    bool ok = true;
+    *count = 0;
+    while (fgets(buf, sizeof(buf), fp)) {
+        char c;
+        unsigned t, n;
+        if (sscanf(buf, "%c %u %u", &c, &t, &n) != 3 || c != name || t >= threads || (int)n != last[t] + 1) {
+            ok = false;
+            break;
+        }
+        last[t] = n;
+        (*count)++;
+    }
+    fclose(fp);
+    return ok;
+}
+
+/* each thread alternates between two live printers, each keeps its own ring */
+static void test_two()
+{
+    char path_a[] = "/tmp/test_async_printer_a.XXXXXX";
+    char path_b[] = "/tmp/test_async_printer_b.XXXXXX";
+    int fd_a = mkstemp(path_a);
+    int fd_b = mkstemp(path_b);
+    {
+        ll::async_printer a(fd_a, 16 * 1024, ll::async_printer::policy_block);
+        ll::async_printer b(fd_b, 16 * 1024, ll::async_printer::policy_block);
+        a.open();
+        b.open();
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; i++) {
+            workers.emplace_back([i, &a, &b]() {
+                char buf[64];
+                for (unsigned n = 0; n < lines; n++) {
+                    a.write(buf, snprintf(buf, sizeof(buf), "a %u %u\n", i, n));
+                    b.write(buf, snprintf(buf, sizeof(buf), "b %u %u\n", i, n));
+                }
+            });
+        }
+        for (auto &th : workers) {
+            th.join();
+        }
+    }
+
+    unsigned count_a, count_b;
+    bool ok = check_order(path_a, 'a', &count_a);
+    ok = check_order(path_b, 'b', &count_b) && ok;
+    cout << "two printers: " << count_a << " and " << count_b << " of " << threads * lines
+         << " lines, ok " << (ok && count_a == threads * lines && count_b == threads * lines) << endl;
+    ::close(fd_a);
+    ::close(fd_b);
+    unlink(path_a);
+    unlink(path_b);
+}
+
+int main()
+{
+    /* block: every line arrives */
+    char path[] = "/tmp/test_async_printer.XXXXXX";
+    int fd = mkstemp(path);
+    {
+        ll::async_printer printer(fd, 16 * 1024, ll::async_printer::policy_block);
+        ll::timeval tv = run(&printer);
+        cout << "block: " << count_lines(path) << " of " << threads * lines << " lines, "
+             << "dropped " << printer.dropped() << ", time " << tv << endl;
+    }
+    ::close(fd);
+    unlink(path);
+
+    /* drop: the callers never wait, a slow sink costs lines instead */
+    fd = ::open("/dev/null", O_WRONLY);
+    {
+        ll::async_printer printer(fd, 1024, ll::async_printer::policy_drop);
+        ll::timeval tv = run(&printer);
+        cout << "drop: dropped " << printer.dropped() << " of " << threads * lines
+             << ", time " << tv << endl;
+    }
+    ::close(fd);
+
+    test_two();
+
+    ll::info("back on the default printer\n");
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/binlog.h"
+#include "libll++/async_printer.h"
+#include "libll++/timeval.h"
+
+static constexpr unsigned threads = 2;
+static constexpr unsigned calls = 200000;
+
+template <typename _F>
+static ll::timeval run(_F f)
+{
+    ll::time_trace t;
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([i, &f]() {
+            for (unsigned n = 0; n < calls; n++) {
+                f(i, n);
+            }
+        });
+    }
+    for (auto &th : workers) {
+        th.join();
+    }
+    return t.check();
+}
+
+/* the whole file, decoded, without the line headers */
+static std::string decode(int fd)
+{
+    std::string data, out, errors;
+    char buf[65536];
+    ssize_t n;
+    lseek(fd, 0, SEEK_SET);
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+        data.append(buf, n);
+    }
+    if (ll_failed(ll::binlog_decode(data.data(), data.size(), out, &errors)) || !errors.empty()) {
+        return "error: " + errors;
+    }
+
+    size_t header = ll::log_header(ll::log_type_info, 0, buf, sizeof(buf));
+    std::string text;
+    size_t pos = 0, end;
+    while ((end = out.find('\n', pos)) != std::string::npos) {
+        text.append(out, pos + header, end + 1 - pos - header);
+        pos = end + 1;
+    }
+    return text;
+}
+
+/* what printf makes of the same call */
+template <typename ..._Args>
+static void expect(std::string &text, const char *fmt, _Args...args)
+{
+    char buf[256];
+    text.append(buf, snprintf(buf, sizeof(buf), fmt, args...));
+}
+
+/* every argument kind through the stream and back, across a reopen */
+static bool test_roundtrip()
+{
+    char path[] = "/tmp/test_binlog.XXXXXX";
+    int fd = mkstemp(path);
+    ll::binlog binlog(fd);
+    std::string text;
+    const char *null = nullptr;
+    int local;
+
+    binlog.open();
+    ll_binlog_info("str %s %-6s| %.3s %s\n", "abc", "pad", "truncate", null);
+    expect(text, "str %s %-6s| %.3s %s\n", "abc", "pad", "tru", "");
+    ll_binlog_info("chr %c%c %3c\n", 'o', 'k', '!');
+    expect(text, "chr %c%c %3c\n", 'o', 'k', '!');
+    ll_binlog_error("i64 %lld %llu %llx %d%%\n", -5000000000LL, 18000000000000000000ULL, 0x123456789abcULL, -1);
+    expect(text, "i64 %lld %llu %llx %d%%\n", -5000000000LL, 18000000000000000000ULL, 0x123456789abcULL, -1);
+    binlog.close();
+
+    binlog.open();
+    ll_binlog_info("ptr %p %u %.2f %x\n", (void*)&local, 4000000000U, 2.5, 255u);
+    expect(text, "ptr %p %u %.2f %x\n", (void*)&local, 4000000000U, 2.5, 255u);
+    binlog.close();
+
+    std::string got = decode(fd);
+    ::close(fd);
+    unlink(path);
+    cout << got;
+    return got == text;
+}
+
+/* a ring too small for the burst, the drops come back as one line each report */
+static bool test_drop()
+{
+    char path[] = "/tmp/test_binlog.XXXXXX";
+    int fd = mkstemp(path);
+    ll::binlog binlog(fd, 1024, ll::async_printer::policy_drop);
+    binlog.open();
+    for (unsigned i = 0; i < 10000; i++) {
+        ll_binlog_info("drop %u\n", i);
+    }
+    binlog.close();
+
+    std::string got = decode(fd);
+    ::close(fd);
+    unlink(path);
+
+    unsigned long lines = 0, dropped = 0;
+    size_t pos = 0, end;
+    while ((end = got.find('\n', pos)) != std::string::npos) {
+        unsigned long n;
+        if (sscanf(got.c_str() + pos, "binlog: %lu records dropped", &n) == 1) {
+            dropped += n;
+        }
+        else if (got.compare(pos, 5, "drop ")) {
+            return false;
+        }
+        else {
+            lines++;
+        }
+        pos = end + 1;
+    }
+    cout << "drop: lines=" << lines << " dropped=" << dropped << endl;
+    return dropped && dropped == binlog.dropped() && lines + dropped == 10000;
+}
+
+/* a site record, signature "", file "f" and fmt "ok\n", cut to size when size is given */
+static void add_site(std::string &data, uint32_t id, uint32_t size = 0)
+{
+    static const char strings[] = "\0f\0ok\n";
+    ll::binlog_helper::site_record sr;
+    memset(&sr, 0, sizeof(sr));
+    sr._size = size ? size : sizeof(sr) + sizeof(strings);
+    sr._site = id;
+    sr._type = ll::log_type_info;
+
+    std::string record((const char*)&sr, sizeof(sr));
+    record.append(strings, sizeof(strings));
+    record.resize(sr._size);
+    data += record;
+}
+
+/* corrupt site records are reported and skipped, the good ones still decode */
+static bool test_malformed()
+{
+    std::string data(ll::binlog_helper::magic, sizeof(ll::binlog_helper::magic));
+    add_site(data, 0);
+    add_site(data, 0xffffffff);
+    add_site(data, 1, sizeof(ll::binlog_helper::record) + 4);
+    add_site(data, 1);
+
+    ll::binlog_helper::entry_record er;
+    memset(&er, 0, sizeof(er));
+    er._size = sizeof(er);
+    er._id = 1;
+    data.append((const char*)&er, sizeof(er));
+
+    std::string out, errors;
+    int rc = ll::binlog_decode(data.data(), data.size(), out, &errors);
+    unsigned corrupt = 0;
+    for (size_t pos = 0; (pos = errors.find("corrupt", pos)) != std::string::npos; pos++) {
+        corrupt++;
+    }
+    cout << "malformed: " << errors;
+    return rc == ll::ok && corrupt == 3 && out.size() > 3 && !out.compare(out.size() - 3, 3, "ok\n");
+}
+
+int main()
+{
+    ll_binlog_info("before open, printed by %s\n", "log");
+
+    bool ok = test_roundtrip();
+    cout << "roundtrip ok=" << ok << endl;
+    ok = test_drop();
+    cout << "drop ok=" << ok << endl;
+    ok = test_malformed();
+    cout << "malformed ok=" << ok << endl;
+
+    char path[] = "/tmp/test_binlog.XXXXXX";
+    int fd = mkstemp(path);
+    ll::binlog binlog(fd, 256 * 1024, ll::async_printer::policy_block);
+    binlog.open();
+
+    /* ns per call on the calling threads, the writer runs beside them */
+    ll::timeval tv = run([](unsigned i, unsigned n) {
+        ll_binlog_info("thread %u call %u value %.3f tag %s\n", i, n, n * 0.5, "binlog");
+    });
+    ll_binlog_error("%d%% %c %lld %p\n", -1, 'x', -5000000000LL, (void*)&tv);
+    binlog.close();
+
+    struct stat st;
+    fstat(fd, &st);
+    cout << "binlog: " << tv * 1000 / (threads * calls) << " ns/call, "
+         << st.st_size << " bytes, dropped " << binlog.dropped() << endl;
+    ::close(fd);
+    unlink(path);
+
+    /* the same lines formatted on the calling threads */
+    int null = ::open("/dev/null", O_WRONLY);
+    ll::async_printer printer(null, 256 * 1024, ll::async_printer::policy_block);
+    printer.open();
+    ll::log::set_printter(&printer);
+    tv = run([](unsigned i, unsigned n) {
+        ll::info("thread %u call %u value %.3f tag %s\n", i, n, n * 0.5, "binlog");
+    });
+    ll::log::set_printter();
+    cout << "text: " << tv * 1000 / (threads * calls) << " ns/call" << endl;
+    ::close(null);
+    return 0;
+}
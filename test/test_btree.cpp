@@ -0,0 +1,153 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+
+#include "libll++/malloc_allocator.h"
+#include "libll++/map.h"
+#include "libll++/btree.h"
+#include "libll++/timeval.h"
+
+struct foo {
+    ll::map_entry _entry;
+    unsigned _key;
+    foo(unsigned key) : _key(key) {}
+
+    static unsigned get_key(foo *f) {
+        return f->_key;
+    }
+};
+
+static constexpr unsigned total = 1000000;
+
+/* the values of tree walked back from end() are those of map, reversed */
+template <typename _Tree, typename _Map>
+static bool same_backwards(_Tree &tree, _Map &map)
+{
+    std::vector<unsigned> keys;
+    for (auto &f : map) {
+        keys.push_back(f._key);
+    }
+    if (tree.count() != keys.size()) {
+        return false;
+    }
+    auto it = tree.end();
+    for (size_t i = keys.size(); i > 0; i--) {
+        if ((--it)->_key != keys[i - 1]) {
+            return false;
+        }
+    }
+    return it == tree.begin();
+}
+
+/* random single key inserts and removes, checked against ll_map */
+static void test_random()
+{
+    static constexpr unsigned range = 4096;
+    ll::malloc_allocator a;
+    ll::btree<unsigned, foo> tree(&a);
+    ll_map(unsigned, foo, _entry, ll::malloc_allocator) map;
+    std::vector<foo> pool;
+    for (unsigned i = 0; i < range; i++) {
+        pool.emplace_back(i);
+    }
+
+    assert(tree.end() == --tree.end() && same_backwards(tree, map));
+    for (unsigned round = 0; round < 200000; round++) {
+        foo *f = &pool[rand() % range];
+        if (rand() % 3) {
+            bool in = map.get(f->_key) != nullptr;
+            assert(tree.insert(f) == f);
+            if (!in) {
+                map.insert(f);
+            }
+        }
+        else {
+            foo *elm = map.remove(f->_key);
+            assert(tree.remove(f->_key) == elm);
+        }
+        if (!(round % 10000)) {
+            assert(same_backwards(tree, map));
+        }
+    }
+    assert(same_backwards(tree, map));
+    cout << "random count=" << tree.count() << " height=" << tree.height() << endl;
+
+    /* down to nothing, one key at a time */
+    while (foo *f = map.front()) {
+        map.remove(f);
+        assert(tree.remove(f->_key) == f);
+    }
+    assert(tree.empty() && same_backwards(tree, map));
+}
+
+int main()
+{
+    ll::malloc_allocator a;
+    ll::btree<unsigned, foo> tree(&a);
+    ll_map(unsigned, foo, _entry, ll::malloc_allocator) map;
+
+    unsigned *keys = new unsigned[total];
+    for (unsigned i = 0; i < total; i++) {
+        keys[i] = i * 2;
+    }
+    for (unsigned i = total - 1; i > 0; i--) {
+        std::swap(keys[i], keys[rand() % (i + 1)]);
+    }
+
+    ll::time_trace t;
+    for (unsigned i = 0; i < total; i++) {
+        tree.probe(keys[i], nullptr);
+    }
+    ll::timeval tv_tree = t.check();
+    for (unsigned i = 0; i < total; i++) {
+        map.probe(keys[i], nullptr);
+    }
+    ll::timeval tv_map = t.check();
+    cout << "insert btree=" << tv_tree << " map=" << tv_map << " height=" << tree.height() << endl;
+
+    unsigned found = 0;
+    t.check();
+    for (unsigned i = 0; i < total; i++) {
+        found += tree.get(keys[i]) != nullptr;
+    }
+    tv_tree = t.check();
+    for (unsigned i = 0; i < total; i++) {
+        found += map.get(keys[i]) != nullptr;
+    }
+    tv_map = t.check();
+    assert(found == total * 2);
+    cout << "lookup btree=" << tv_tree << " map=" << tv_map << endl;
+
+    unsigned long sum = 0;
+    t.check();
+    for (auto &f : tree) {
+        sum += f._key;
+    }
+    tv_tree = t.check();
+    for (auto &f : map) {
+        sum -= f._key;
+    }
+    tv_map = t.check();
+    assert(!sum);
+    cout << "iterate btree=" << tv_tree << " map=" << tv_map << endl;
+
+    /* bounds and range erase */
+    assert(tree.lower_bound(1001)->_key == 1002);
+    assert(tree.upper_bound(1002)->_key == 1004);
+    size_t n = tree.remove(1000, 3000, [&map](foo *f) {
+        map.remove(f->_key);
+    });
+    assert(n == 1000 && tree.count() == total - 1000);
+    assert(tree.lower_bound(1000)->_key == 3000);
+    assert(map.get(2000) == nullptr);
+    cout << "removed=" << n << " count=" << tree.count() << endl;
+
+    delete[] keys;
+
+    test_random();
+    return 0;
+}
@@ -113,6 +113,26 @@ int main()
         c(100);
     } while (0);
 
+    do {
+        /* fits in place, no allocation */
+        ll::inline_closure<void(int)> c;
+        c.set(nullptr, &foo2::dodo, p, n);
+        c(100);
+        cout << "inline: " << ((char*)c.get() == (char*)&c + sizeof(void*)) << endl;
+        c.reset(nullptr);
+    } while (0);
+
+    do {
+        /* too big for the buffer, falls back to the allocator */
+        char pad[64] = "heap";
+        ll::inline_closure<void(int)> c;
+        c.set(nullptr, [pad](int m) {
+            cout << pad << ":" << m << endl;
+        });
+        c(100);
+        c.reset(nullptr);
+    } while (0);
+
     return 0;
 }
 
@@ -0,0 +1,70 @@
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "libll++/connection.h"
+#include "libll++/timeval.h"
+
+struct peer {
+    ll::reactor reactor;
+    ll::timer_manager timermgr;
+    ll::connection conn;
+    unsigned received;
+    unsigned events;
+
+    peer() : reactor(), timermgr(), conn(&reactor, &timermgr), received(), events() {}
+
+    int handler(ll::connection &c, int type) {
+        events++;
+        if (type & ll::connection::ev_read) {
+            received += c.input().size();
+            c.input().clear();
+        }
+        if (type & ll::connection::ev_full) {
+            cout << "full, backlog=" << c.backlog() << endl;
+        }
+        if (type & ll::connection::ev_drain) {
+            cout << "drain, backlog=" << c.backlog() << endl;
+        }
+        if (type & ll::connection::ev_close) {
+            cout << "closed" << endl;
+        }
+        return 0;
+    }
+};
+
+int main()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return -1;
+    }
+
+    peer a, b;
+    a.conn.set_watermarks(256 * 1024, 16 * 1024);
+    ll_failed_return(a.conn.open(fds[0], &peer::handler, &a));
+    ll_failed_return(b.conn.open(fds[1], &peer::handler, &b));
+
+    /* many small writes are coalesced into one flush per iteration */
+    const char msg[] = "0123456789abcdef";
+    for (unsigned i = 0; i < 65536; i++) {
+        a.conn.write(msg, sizeof(msg) - 1);
+    }
+    cout << "backlog=" << a.conn.backlog() << " writable=" << a.conn.writable() << endl;
+
+    while (b.received < 65536 * (sizeof(msg) - 1)) {
+        ll::timeval t = a.timermgr.loop();
+        b.timermgr.loop();
+        ll_failed_return(a.reactor.loop(ll::time_prec_msec::to_timeval(10) < t ? ll::time_prec_msec::to_timeval(10) : t));
+        ll_failed_return(b.reactor.loop(ll::time_prec_msec::to_timeval(10)));
+    }
+
+    cout << "received=" << b.received << " events=" << b.events << " backlog=" << a.conn.backlog() << endl;
+    a.conn.close();
+    b.conn.close();
+    return 0;
+}
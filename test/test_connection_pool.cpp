@@ -0,0 +1,133 @@
+#include <iostream>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+#include <unistd.h>
+
+#include "libll++/connection_pool.h"
+#include "libll++/timeval.h"
+
+struct server {
+    ll::reactor reactor;
+    ll::timer_manager timermgr;
+    ll::addrinfo addr;
+    ll::listener listener;
+    std::vector<int> fds;
+
+    server() : reactor(), timermgr() {}
+
+    int accept_handler(ll::listener&, int fd, int type, ll::address&) {
+        if (type & ll::reactor::poll_in) {
+            fds.push_back(fd);
+        }
+        return 0;
+    }
+
+    /* the server end of every pooled connection goes away */
+    void hangup() {
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        fds.clear();
+    }
+
+    template <typename _Cond>
+    bool run(_Cond cond) {
+        for (unsigned i = 0; i < 200 && !cond(); i++) {
+            ll::timeval t = timermgr.loop();
+            ll::timeval tick = ll::time_prec_msec::to_timeval(10);
+            if (ll_failed(reactor.loop(t < tick ? t : tick))) {
+                return false;
+            }
+        }
+        return cond();
+    }
+};
+
+struct client {
+    int fd;
+    unsigned calls;
+
+    client() : fd(-1), calls() {}
+
+    int handler(ll::connection_pool&, int fd) {
+        this->fd = fd;
+        calls++;
+        return 0;
+    }
+};
+
+static void report(const char *what, ll::connection_pool &pool)
+{
+    cout << what << ": idle=" << pool.idle_count() << " active=" << pool.active_count()
+         << " connecting=" << pool.connecting_count() << " waiting=" << pool.waiting_count() << endl;
+}
+
+int main()
+{
+    server s;
+    ll_failed_return(s.addr.init("127.0.0.1:23457", ll::pool::global()));
+    ll_failed_return(s.addr.resolve());
+    s.listener.set_addr(s.addr);
+    s.listener.set_reactor(&s.reactor);
+    s.listener.set_timer_manager(&s.timermgr);
+    ll_failed_return(s.listener.listen(&server::accept_handler, &s));
+
+    ll::connection_pool pool(s.addr, &s.reactor, &s.timermgr);
+    pool.set_connect_timeout(ll::time_prec_msec::to_timeval(1000));
+
+    /* nothing idle, the checkout is served once the connect finishes */
+    client c;
+    cout << "sync acquire " << (pool.acquire() == ll::e_notready ? "notready" : "?") << endl;
+    ll_failed_return(pool.acquire(&client::handler, &c));
+    s.run([&]() { return c.calls != 0; });
+    cout << "async acquire " << (c.fd >= 0 ? "connected" : "failed") << endl;
+    report("checked out", pool);
+
+    /* the released fd is the next one handed out */
+    int fd = c.fd;
+    pool.release(fd);
+    report("released", pool);
+    int again = pool.acquire();
+    cout << "reused " << (again == fd) << endl;
+    pool.release(again);
+
+    /* a hangup of the idle connection is seen by the reactor, no checkout needed */
+    s.run([&]() { return s.fds.size() == 1; });
+    s.hangup();
+    s.run([&]() { return pool.idle_count() == 0; });
+    report("after hangup", pool);
+    cout << "stale acquire " << (pool.acquire() == ll::e_notready ? "notready" : "?") << endl;
+
+    /* keepalive fills the pool up to min_idle and keeps it there */
+    pool.set_keepalive(3, ll::time_prec_msec::to_timeval(20));
+    s.run([&]() { return pool.idle_count() == 3; });
+    report("keepalive", pool);
+
+    /* release and acquire cycle through the same spare entries */
+    int fds[3];
+    for (int &f : fds) {
+        f = pool.acquire();
+    }
+    report("all out", pool);
+    for (int f : fds) {
+        pool.release(f);
+    }
+    report("all back", pool);
+
+    /* a probe failure drops every idle connection, keepalive reconnects */
+    bool probe_fail = true;
+    pool.set_probe([&](ll::connection_pool&, int) { return probe_fail ? ll::fail : ll::ok; });
+    s.run([&]() { return s.fds.size() >= 6; });
+    probe_fail = false;
+    s.run([&]() { return pool.idle_count() == 3; });
+    report("after probe", pool);
+
+    pool.close();
+    report("closed", pool);
+    s.hangup();
+    s.listener.close();
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <iostream>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/coroutine.h"
+#include "libll++/timeval.h"
+
+ll::reactor reactor;
+ll::timer_manager timermgr;
+bool done;
+
+static constexpr size_t block_size = 4096;
+static constexpr unsigned blocks = 16;
+
+/* the frame comes from the pool, the first pool* parameter */
+ll::task echo(ll::pool *pool, int fd)
+{
+    ll::co_io io;
+    if (ll_failed(io.open(&reactor, fd, ll::reactor::poll_in | ll::reactor::poll_err | ll::reactor::poll_hup))) {
+        co_return;
+    }
+
+    while (1) {
+        int flags = co_await io.readable();
+        char buf[256];
+        int n;
+        while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+            ::write(fd, buf, n);
+        }
+        if (n == 0 || (flags & (ll::reactor::poll_err | ll::reactor::poll_hup))) {
+            cout << "echo closed" << endl;
+            break;
+        }
+    }
+}
+
+ll::task client(int fd)
+{
+    ll::co_io io;
+    io.open(&reactor, fd, ll::reactor::poll_in | ll::reactor::poll_err);
+
+    for (int i = 0; i < 3; i++) {
+        char buf[64];
+        int len = snprintf(buf, sizeof(buf), "ping %d", i);
+        ::write(fd, buf, len);
+
+        co_await io.readable();
+        int n = ::read(fd, buf, sizeof(buf) - 1);
+        buf[n > 0 ? n : 0] = '\0';
+        cout << "client got: " << buf << endl;
+
+        co_await ll::sleep(timermgr, ll::time_prec_msec::to_timeval(100));
+    }
+    done = true;
+}
+
+/* the accepted end, reads the whole upload then answers */
+ll::task serve(ll::pool *pool, int fd)
+{
+    ll::connection conn(&reactor, &timermgr);
+    if (ll_failed(conn.open(fd))) {
+        co_return;
+    }
+    ll::co_connection c(&conn);
+
+    int n = co_await ll::stream_read(c, block_size * blocks);
+    cout << "serve got " << n << endl;
+    conn.input().clear();
+    conn.write("done", 4);
+
+    /* nothing more comes, the client's close ends the read */
+    n = co_await c.read(1);
+    cout << "serve read after close " << (n == ll::e_closed ? "closed" : "?") << endl;
+
+    /* the connection is still emitting, end from the timer loop */
+    co_await ll::sleep(timermgr, ll::time_prec_msec::to_timeval(1));
+}
+
+int accept_handler(ll::listener&, int fd, int type, ll::address&)
+{
+    if (type & ll::reactor::poll_in) {
+        serve(ll::pool::global(), fd);
+    }
+    return 0;
+}
+
+/* connects, uploads past the high watermark, waits for the drain and the answer */
+ll::task upload(ll::connector &connector)
+{
+    int fd = co_await ll::connect(connector);
+    if (ll_failed(fd)) {
+        cout << "upload connect failed" << endl;
+        done = true;
+        co_return;
+    }
+
+    ll::connection conn(&reactor, &timermgr);
+    conn.set_watermarks(block_size, block_size / 4);
+    conn.open(fd);
+    ll::co_connection c(&conn);
+
+    static char block[block_size];
+    memset(block, 'x', sizeof(block));
+    for (unsigned i = 0; i < blocks; i++) {
+        conn.write(block, sizeof(block));
+    }
+    cout << "upload writable=" << conn.writable() << endl;
+    int rc = co_await c.drain();
+    cout << "upload drained rc=" << rc << " writable=" << conn.writable() << endl;
+
+    int n = co_await c.read(4);
+    char buf[5] = {};
+    conn.input().data().peek(buf, 4);
+    cout << "upload got " << n << " " << buf << endl;
+    conn.close();
+
+    /* let the server see the close */
+    co_await ll::sleep(timermgr, ll::time_prec_msec::to_timeval(50));
+    done = true;
+}
+
+/* nothing listens there */
+ll::task refused(ll::connector &connector)
+{
+    int fd = co_await ll::connect(connector);
+    cout << "refused " << (ll_failed(fd) ? "failed" : "connected") << endl;
+    done = true;
+}
+
+static int run()
+{
+    done = false;
+    while (!done) {
+        ll::timeval t = timermgr.loop();
+        ll_failed_return(reactor.loop(t));
+    }
+    return ll::ok;
+}
+
+int main()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+        return 1;
+    }
+
+    echo(ll::pool::global(), fds[1]);
+    client(fds[0]);
+    ll_failed_return(run());
+    ::close(fds[0]);
+
+    ll::addrinfo addr;
+    ll_failed_return(addr.init("127.0.0.1:23458", ll::pool::global()));
+    ll_failed_return(addr.resolve());
+    ll::listener listener;
+    listener.set_addr(addr);
+    listener.set_reactor(&reactor);
+    listener.set_timer_manager(&timermgr);
+    ll_failed_return(listener.listen(accept_handler));
+
+    ll::connector connector(addr, &reactor, &timermgr, ll::time_prec_msec::to_timeval(1000), 0);
+    upload(connector);
+    ll_failed_return(run());
+    listener.close();
+
+    /* the listener is gone, the same address now refuses */
+    refused(connector);
+    ll_failed_return(run());
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <cassert>
+
+#include "libll++/crc.h"
+#include "libll++/stream.h"
+#include "libll++/timeval.h"
+
+template <typename _Crc>
+static uint32_t bytewise(const void *buf, size_t len, uint32_t crc)
+{
+    const uint8_t *p = (const uint8_t*)buf;
+    while (len--) {
+        crc = _Crc::make(crc, *p++);
+    }
+    return crc;
+}
+
+template <typename _Crc>
+static void check(const char *name, uint32_t expected)
+{
+    static char buf[4096];
+    for (unsigned i = 0; i < sizeof(buf); i++) {
+        buf[i] = (char)(i * 131 + 7);
+    }
+
+    assert(~bytewise<_Crc>("123456789", 9, ~0U) == expected);
+    assert(~_Crc::make("123456789", 9, ~0U) == expected);
+    for (size_t len = 0; len < 1024; len += 13) {
+        uint32_t crc = bytewise<_Crc>(buf + 3, len, ~0U);
+        assert(_Crc::make(buf + 3, len, ~0U) == crc);
+        assert(_Crc::make_table(buf + 3, len, ~0U) == crc);
+
+        /* two halves summed apart then joined */
+        size_t half = len / 2;
+        assert(_Crc::combine(_Crc::make(buf + 3, half, ~0U), _Crc::make(buf + 3 + half, len - half, 0),
+                             len - half) == crc);
+    }
+
+    /* a stream is summed chunk by chunk */
+    ll::stream s;
+    for (unsigned i = 0; i < 64; i++) {
+        s.write(buf, sizeof(buf));
+    }
+    uint32_t crc = ~0U;
+    for (unsigned i = 0; i < 64; i++) {
+        crc = _Crc::make(buf, sizeof(buf), crc);
+    }
+    assert(_Crc::make_chunks(s, ~0U) == crc);
+
+    cout << name << " backend=" << _Crc::backend() << endl;
+
+    static const size_t sizes[] = {16, 64, 256, 4096};
+    for (size_t size : sizes) {
+        unsigned rounds = (256 * 1024 * 1024) / size;
+        uint32_t x = 0;
+        ll::time_trace t;
+
+        for (unsigned i = 0; i < rounds / 8; i++) {
+            x += bytewise<_Crc>(buf, size, x);
+        }
+        ll::timeval tv_bytes = t.check();
+
+        for (unsigned i = 0; i < rounds; i++) {
+            x += _Crc::make_table(buf, size, x);
+        }
+        ll::timeval tv_table = t.check();
+
+        for (unsigned i = 0; i < rounds; i++) {
+            x += _Crc::make(buf, size, x);
+        }
+        ll::timeval tv_best = t.check();
+
+        /* bytewise ran over 1/8 of the data */
+        cout << "  size=" << size << " bytewise(x8)=" << tv_bytes << " slice8=" << tv_table
+             << " " << _Crc::backend() << "=" << tv_best << " (" << x << ")" << endl;
+    }
+}
+
+int main()
+{
+    check<ll::crc32>("crc32", 0xcbf43926U);
+    check<ll::crc32c>("crc32c", 0xe3069283U);
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+#include <sys/socket.h>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/datagram.h"
+#include "libll++/timeval.h"
+
+static constexpr unsigned total = 100000;
+
+struct peer {
+    ll::reactor reactor;
+    ll::timer_manager timermgr;
+    ll::addrinfo addr;
+    ll::datagram dgram;
+    unsigned received;
+    unsigned batches;
+
+    peer() : reactor(), timermgr(), dgram(&reactor, &timermgr), received(), batches() {}
+
+    int handler(ll::datagram&, ll::datagram::packet *pkts, unsigned n) {
+        batches++;
+        for (unsigned i = 0; i < n; i++) {
+            received += pkts[i].segments();
+        }
+        return 0;
+    }
+
+    int open(const char *uri) {
+        ll_failed_return(addr.init(uri, ll::pool::global()));
+        ll_failed_return(addr.resolve());
+        return dgram.bind(addr, &peer::handler, this);
+    }
+
+    void loop() {
+        timermgr.loop();
+        reactor.loop(ll::time_prec_msec::to_timeval(10));
+    }
+};
+
+/* the receiver checks the sequence and the payload of every datagram */
+struct sink {
+    unsigned next;
+    unsigned bad;
+
+    sink() : next(), bad() {}
+
+    static unsigned size_of(unsigned seq) {
+        return 8 + seq % 997;
+    }
+
+    static void fill(char *buf, unsigned seq) {
+        memset(buf, (char)seq, size_of(seq));
+        memcpy(buf, &seq, sizeof(seq));
+    }
+
+    int handler(ll::datagram&, ll::datagram::packet *pkts, unsigned n) {
+        char buf[1024];
+        for (unsigned i = 0; i < n; i++) {
+            fill(buf, next);
+            if (pkts[i]._size != size_of(next) || memcmp(pkts[i]._data, buf, pkts[i]._size)) {
+                bad++;
+            }
+            next++;
+        }
+        return 0;
+    }
+};
+
+/* a small send buffer on a unix socketpair makes every flush partial, the queue
+ * never drains while new datagrams keep coming, so the consumed part of the
+ * send buffer has to be reclaimed on each shift */
+static void test_partial()
+{
+    constexpr unsigned count = 5000;
+    int fds[2];
+    assert(!::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+    int n = 4096;
+    ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &n, sizeof(n));
+
+    ll::reactor reactor;
+    ll::timer_manager timermgr;
+    ll::datagram a(&reactor, &timermgr), b(&reactor, &timermgr);
+    sink s;
+    ll::address to;         /* empty, the socketpair is connected */
+    assert(a.open(fds[0]) == ll::ok);
+    assert(b.open(fds[1], &sink::handler, &s) == ll::ok);
+
+    char buf[1024];
+    unsigned sent = 0, partial = 0, bytes = 0;
+    while (s.next < count) {
+        while (sent < count && a.backlog() < 32) {
+            sink::fill(buf, sent);
+            assert(a.send(buf, sink::size_of(sent), to) == ll::ok);
+            bytes += sink::size_of(sent);
+            sent++;
+        }
+        a.flush();
+        if (a.backlog()) {
+            partial++;
+        }
+        reactor.loop(ll::time_prec_msec::to_timeval(1));
+    }
+
+    cout << "partial: sent=" << sent << " bytes=" << bytes << " received=" << s.next
+         << " bad=" << s.bad << " partial flushes=" << partial << " drops=" << a.drops() << endl;
+    assert(s.next == count && !s.bad && !a.drops());
+    assert(bytes > ll::datagram::buffer_size);
+    a.close();
+    b.close();
+}
+
+int main()
+{
+    test_partial();
+
+    peer a, b;
+    ll_failed_return(a.open("127.0.0.1:23457"));
+    ll_failed_return(b.open("127.0.0.1:23458"));
+
+    const char msg[] = "0123456789abcdef0123456789abcdef";
+    ll::timeval start = ll::time::now();
+    unsigned sent = 0;
+    while (sent < total) {
+        /* queue one batch, the kernel takes it in one sendmmsg */
+        for (unsigned i = 0; i < ll::datagram::max_batch && sent < total; i++) {
+            if (a.dgram.send(msg, sizeof(msg) - 1, b.addr) != ll::ok) {
+                break;
+            }
+            sent++;
+        }
+        a.loop();
+        b.loop();
+    }
+
+    for (unsigned i = 0; i < 100 && b.received < total; i++) {
+        a.loop();
+        b.loop();
+    }
+    ll::timeval elapsed = ll::time::now() - start;
+
+    cout << "sent=" << sent << " received=" << b.received << " batches=" << b.batches
+         << " drops=" << a.dgram.drops() << " errors=" << a.dgram.errors()
+         << " usecs=" << elapsed << endl;
+    a.dgram.close();
+    b.dgram.close();
+    return 0;
+}
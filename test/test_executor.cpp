@@ -0,0 +1,132 @@
+#include <iostream>
+#include <atomic>
+#include <string>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/executor.h"
+#include "libll++/reactor.h"
+#include "libll++/timeval.h"
+
+static std::atomic<unsigned long> counter(0);
+
+/* each task forks two more until depth runs out, exercises the worker deques */
+static void fork(ll::executor *e, unsigned depth)
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+    if (depth) {
+        e->submit(fork, e, depth - 1);
+        e->submit(fork, e, depth - 1);
+    }
+}
+
+static std::atomic<bool> gate(false);
+static std::atomic<unsigned long> sum(0);
+
+static void add(std::string s, unsigned long v)
+{
+    sum.fetch_add(s.size() + v, std::memory_order_relaxed);
+    counter.fetch_add(1, std::memory_order_release);
+}
+
+/* the arguments are lvalues of this frame, the job runs after it returned */
+static void submit_from_frame(ll::executor *e, unsigned long i)
+{
+    unsigned long v = i;
+    std::string s(i % 64, 'x');
+    auto fn = add;
+    e->submit(fn, s, v);
+}
+
+static void test_lifetime()
+{
+    static constexpr unsigned long jobs = 1000;
+    ll::executor e(1);
+    unsigned long expect = 0;
+
+    /* holds the only worker until every submitting frame is gone */
+    e.submit([]() {
+        while (!gate.load()) {
+            std::this_thread::yield();
+        }
+    });
+    for (unsigned long i = 0; i < jobs; i++) {
+        submit_from_frame(&e, i);
+        expect += i % 64 + i;
+    }
+    gate = true;
+
+    while (counter.load() < jobs) {
+        std::this_thread::yield();
+    }
+    cout << "lifetime: sum=" << sum.load() << " ok=" << (sum.load() == expect) << endl;
+    counter = 0;
+}
+
+int main()
+{
+    static constexpr unsigned count = 1000000;
+
+    test_lifetime();
+
+    do {
+        ll::executor e;
+        cout << "threads: " << e.threads() << endl;
+
+        ll::time_trace t;
+        for (unsigned i = 0; i < count; i++) {
+            e.submit([]() { counter.fetch_add(1, std::memory_order_relaxed); });
+        }
+        while (counter.load() < count) {
+            std::this_thread::yield();
+        }
+        cout << "injected: " << count * 1000ull / (ll::time_prec_msec::to_precval(t.check()) + 1) 
+             << " tasks/s" << endl;
+
+        counter = 0;
+        t.reset();
+        e.submit(fork, &e, 19);
+        while (counter.load() < (1u << 20) - 1) {
+            std::this_thread::yield();
+        }
+        cout << "forked: " << counter.load() * 1000ull / (ll::time_prec_msec::to_precval(t.check()) + 1) 
+             << " tasks/s" << endl;
+    } while (0);
+
+    /* results come back to the reactor thread */
+    do {
+        ll::reactor reactor;
+        ll::completion_queue cq;
+        ll::executor e(4);
+        unsigned done = 0;
+        unsigned long sum = 0;
+
+        if (ll_failed(cq.open(&reactor))) {
+            cout << "open completion queue failed" << endl;
+            return 1;
+        }
+
+        for (unsigned i = 0; i < 100; i++) {
+            unsigned long *result = new unsigned long(0);
+            e.submit_then(&cq, 
+                [i, result]() {
+                    for (unsigned n = 0; n <= i * 1000; n++) {
+                        *result += n;
+                    }
+                },
+                [result, &done, &sum]() {
+                    sum += *result;
+                    done++;
+                    delete result;
+                });
+        }
+
+        while (done < 100) {
+            reactor.loop(ll::time_prec_msec::to_timeval(10));
+        }
+        cout << "completions: " << done << " sum: " << sum << endl;
+        cq.close();
+    } while (0);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <cstdlib>
+
+#include "libll++/hashmap.h"
+#include "libll++/flat_hashmap.h"
+#include "libll++/memory.h"
+#include "libll++/timeval.h"
+
+struct foo {
+    unsigned _key;
+    unsigned _value;
+    foo(unsigned key) : _key(key), _value(key) {}
+
+    ll::hashmap_entry<> entry;
+
+    static unsigned get_key(foo *f) {
+        return f->_key;
+    }
+};
+
+int main()
+{
+    #define COUNT 1000000UL
+
+    do {
+        ll::time_trace t;
+        ll_hashmap(unsigned, foo, entry) map(ll::pool::global(), COUNT);
+        t.check();
+        for (unsigned i = 0; i < COUNT; i++) {
+            map.probe(i, nullptr, ll::pool::global());
+        }
+        ll::timeval tv = t.check();
+        cout << "chained: count=" << map.count() << ", capacity=" << map.capacity() << " insert=" << tv;
+
+        unsigned found = 0;
+        srand(0);
+        for (unsigned i = 0; i < COUNT; i++) {
+            found += map.get(rand() % (COUNT * 2)) != nullptr;
+        }
+        tv = t.check();
+        cout << " get=" << tv << " found=" << found << endl;
+    } while (0);
+
+    do {
+        ll::time_trace t;
+        ll::malloc_allocator allocator;
+        ll::flat_hashmap<unsigned, unsigned> map(&allocator, COUNT);
+        t.check();
+        for (unsigned i = 0; i < COUNT; i++) {
+            map.probe(i, nullptr, i);
+        }
+        ll::timeval tv = t.check();
+        cout << "flat: count=" << map.count() << ", capacity=" << map.capacity() << " insert=" << tv;
+
+        unsigned found = 0;
+        srand(0);
+        for (unsigned i = 0; i < COUNT; i++) {
+            found += map.get(rand() % (COUNT * 2)) != nullptr;
+        }
+        tv = t.check();
+        cout << " get=" << tv << " found=" << found;
+
+        for (unsigned i = 0; i < COUNT; i += 2) {
+            map.remove(i);
+        }
+        tv = t.check();
+        cout << " remove=" << tv << " count=" << map.count() << endl;
+
+        unsigned n = 0;
+        for (auto &elm : map) {
+            n += elm.first == elm.second;
+        }
+        cout << "iterated " << n << endl;
+    } while (0);
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/memory.h"
+#include "libll++/frame_decoder.h"
+
+static int print_frames(ll::frame_decoder&, ll::stream_helper::input *frames, unsigned count)
+{
+    cout << "batch " << count << endl;
+    for (unsigned i = 0; i < count; i++) {
+        char buf[256];
+        size_t n = frames[i].peek(buf, sizeof(buf) - 1);
+        buf[n] = '\0';
+        cout << "  [" << frames[i]._size << "] " << buf << endl;
+    }
+    return 0;
+}
+
+int main()
+{
+    do {
+        ll::stream s;
+        ll::frame_decoder decoder(ll::frame_decoder::mode_varint);
+        decoder.connect(print_frames);
+
+        s.write("\x05hello\x05world\x03", 13);
+        cout << "frames=" << decoder.decode(s) << " left=" << s.size() << endl;
+        s.write("abc", 3);
+        cout << "frames=" << decoder.decode(s) << " left=" << s.size() << endl;
+    } while (0);
+
+    do {
+        ll::stream s;
+        ll::frame_decoder decoder(ll::frame_decoder::mode_fixed16);
+        decoder.connect(print_frames);
+
+        s.write("\x00\x03" "abc" "\x00\x02" "de" "\x00", 10);
+        cout << "frames=" << decoder.decode(s) << " left=" << s.size() << endl;
+        s.write("\x01" "f", 2);
+        cout << "frames=" << decoder.decode(s) << " left=" << s.size() << endl;
+    } while (0);
+
+    do {
+        ll::stream s;
+        ll::frame_decoder decoder(ll::frame_decoder::mode_fixed32, 16);
+        decoder.connect(print_frames);
+
+        s.write("\x00\x00\x01\x00", 4);
+        cout << "oversized=" << decoder.decode(s) << endl;
+    } while (0);
+
+    do {
+        ll::stream s;
+        ll::frame_decoder decoder(ll::frame_decoder::mode_delimiter);
+        decoder.connect(print_frames);
+
+        /* lines spanning several pages */
+        char line[10000];
+        memset(line, 'x', sizeof(line));
+        for (unsigned i = 0; i < 4; i++) {
+            s.write(line, sizeof(line));
+            s.write("\n", 1);
+        }
+        s.write("GET /", 5);
+        cout << "frames=" << decoder.decode(s) << " left=" << s.size() << endl;
+        s.write(" HTTP/1.1\n", 10);
+        cout << "frames=" << decoder.decode(s) << " left=" << s.size() << endl;
+    } while (0);
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <cstring>
+#include <cassert>
+
+#include "libll++/hash.h"
+#include "libll++/timeval.h"
+
+/* the previous byte at a time functions, kept for comparison */
+static ll::hash_t old_hash_string_n(const char *p, size_t size)
+{
+    const unsigned char *str = (const unsigned char *)p;
+    unsigned int r = 0;
+    while (size--) {
+        r = r * 67 + *str++ - 113;
+    }
+    return r;
+}
+
+static ll::hash_t old_hash_iterative(const void *key, unsigned int len, ll::hash_t initval = 0x01000193U)
+{
+    static constexpr uint64_t m = 0xc6a4a7935bd1e995ULL;
+    static constexpr uint64_t r = 47;
+    uint64_t h = ((uint64_t)initval) ^ (len * m);
+    const uint64_t *data = (const uint64_t*)key;
+    const uint64_t *end = data + (len / sizeof(uint64_t));
+    uint64_t k;
+    while (data != end) {
+        memcpy(&k, data++, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    const unsigned char *data2 = (const unsigned char*)data;
+    switch (len & (sizeof(uint64_t) - 1)) {
+    case 7: h ^= (uint64_t)(data2[6]) << 48;
+    case 6: h ^= (uint64_t)(data2[5]) << 40;
+    case 5: h ^= (uint64_t)(data2[4]) << 32;
+    case 4: h ^= (uint64_t)(data2[3]) << 24;
+    case 3: h ^= (uint64_t)(data2[2]) << 16;
+    case 2: h ^= (uint64_t)(data2[1]) << 8;
+    case 1: h ^= (uint64_t)(data2[0]);
+            h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+/* computed by the compiler */
+static constexpr ll::hash_t key_hash = ll::hash_literal("session:42");
+
+int main()
+{
+    static char buf[4096];
+    for (unsigned i = 0; i < sizeof(buf); i++) {
+        buf[i] = (char)(i * 131 + 7);
+    }
+
+    assert(key_hash == ll::hash_string("session:42"));
+    cout << "literal=" << key_hash << endl;
+
+    static const size_t sizes[] = {8, 16, 32, 64, 256, 4096};
+    for (size_t size : sizes) {
+        unsigned rounds = (64 * 1024 * 1024) / size;
+        ll::hash_t x = 0;
+        ll::time_trace t;
+
+        for (unsigned i = 0; i < rounds; i++) {
+            x += old_hash_string_n(buf + (i & 7), size);
+        }
+        ll::timeval tv_bytes = t.check();
+
+        for (unsigned i = 0; i < rounds; i++) {
+            x += old_hash_iterative(buf + (i & 7), size);
+        }
+        ll::timeval tv_murmur = t.check();
+
+        for (unsigned i = 0; i < rounds; i++) {
+            x += ll::hash_string_n(buf + (i & 7), size);
+        }
+        ll::timeval tv_wy = t.check();
+
+        cout << "size=" << size << " bytewise=" << tv_bytes << " murmur=" << tv_murmur
+             << " hash64=" << tv_wy << " (" << x << ")" << endl;
+    }
+
+    ll::hash_t x = 0;
+    ll::time_trace t;
+    for (unsigned i = 0; i < 64 * 1024 * 1024; i++) {
+        x += old_hash_iterative(&i, sizeof(i));
+    }
+    ll::timeval tv_old = t.check();
+    for (unsigned i = 0; i < 64 * 1024 * 1024; i++) {
+        x += ll::hash<unsigned>::make(i);
+    }
+    ll::timeval tv_new = t.check();
+    cout << "unsigned keys murmur=" << tv_old << " hash64_u64=" << tv_new << " (" << x << ")" << endl;
+    return 0;
+}
@@ -32,6 +32,112 @@ struct B : A, foo {
     B(unsigned key) : foo(key) {}
 };
 
+/* a growable map, buckets and elements from the heap */
+struct bar {
+    unsigned _key;
+    ll::hashmap_entry<> _entry;
+    bar(unsigned key) : _key(key) {}
+
+    static unsigned get_key(bar *b) {
+        return b->_key;
+    }
+};
+
+typedef ll_hashmap(unsigned, bar, _entry, ll::malloc_allocator, ll::malloc_allocator) bar_map;
+
+static ll::malloc_allocator heap;
+
+/* keys in [lo, hi) are there, the ones below lo are gone */
+static bool check(bar_map &map, unsigned lo, unsigned hi)
+{
+    for (unsigned i = 0; i < hi; i++) {
+        bar *b = map.get(i);
+        if (i < lo ? b != nullptr : (!b || b->_key != i)) {
+            return false;
+        }
+    }
+    return map.count() == hi - lo;
+}
+
+/* one bucket moves per operation, so inserts, lookups and removes all run
+ * against a half moved table */
+static void test_rehash()
+{
+    bar_map map(&heap, 8);
+    map.set_rehash_step(1);
+
+    unsigned lo = 0, hi = 0;
+    while (!map.rehashing() || map.capacity() + 1 < 4096) {
+        map.probe(hi++, nullptr, &heap);
+    }
+
+    unsigned ops = 0;
+    bool ok = true;
+    while (map.rehashing()) {
+        int flag;
+        bar *b = map.probe(hi, &flag, &heap);
+        ok = ok && flag && b->_key == hi;
+        hi++;
+        b = map.probe(lo + (hi - lo) / 2, &flag, &heap);
+        ok = ok && !flag;
+        b = map.remove(lo);
+        ok = ok && b && b->_key == lo && !map.get(lo);
+        ll::_delete<bar>(&heap, b);
+        lo++;
+        ops += 4;
+    }
+    ok = ok && check(map, lo, hi);
+    cout << "rehash: capacity=" << map.capacity() + 1 << " ops=" << ops << " ok=" << ok << endl;
+    map.clear(&heap);
+}
+
+/* past 2^20 elements the table keeps doubling */
+static void test_grow()
+{
+    bar_map map(&heap, 8);
+    const unsigned n = (1u << 20) + 1;
+    for (unsigned i = 0; i < n; i++) {
+        map.probe(i, nullptr, &heap);
+    }
+    bool ok = check(map, 0, n);
+
+    /* inserts already grew it, expand_if() has nothing to do */
+    unsigned capacity = map.capacity();
+    map.expand_if();
+    ok = ok && map.capacity() == capacity;
+    cout << "grow: count=" << map.count() << " capacity=" << map.capacity() + 1
+         << " ok=" << (ok && map.capacity() + 1 == 1u << 21) << endl;
+    map.clear(&heap);
+}
+
+/* removing while iterating never resizes, shrink() stops at the reserve */
+static void test_shrink()
+{
+    bar_map map(&heap, 8);
+    map.reserve(1024);
+    unsigned floor = map.capacity();
+    for (unsigned i = 0; i < 8192; i++) {
+        map.probe(i, nullptr, &heap);
+    }
+    unsigned grown = map.capacity();
+
+    unsigned removed = 0;
+    for (auto it = map.begin(); it != map.end();) {
+        bar *b = (it++).pointer();
+        if (b->_key >= 16) {
+            map.remove(b);
+            ll::_delete<bar>(&heap, b);
+            removed++;
+        }
+    }
+    bool ok = removed == 8192 - 16 && map.capacity() == grown && check(map, 0, 16);
+
+    map.shrink();
+    ok = ok && map.capacity() == floor && check(map, 0, 16);
+    cout << "shrink: grown=" << grown + 1 << " floor=" << map.capacity() + 1 << " ok=" << ok << endl;
+    map.clear(&heap);
+}
+
 int main()
 {
     #define COUNT 1000000UL
@@ -200,6 +306,10 @@ int main()
         }
     } while (0);
 
+    test_rehash();
+    test_grow();
+    test_shrink();
+
     #if 0
     do {
         ll::time_trace t;
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/log.h"
+#include "libll++/timeval.h"
+
+ll_log_module(net);
+ll_log_module(disk, ll::log_type_error);
+
+/* what ll_log_module(net) in a header gives another translation unit */
+static ll::log_module other_net("net");
+
+static unsigned evaluated = 0;
+
+static unsigned count()
+{
+    return ++evaluated;
+}
+
+int main()
+{
+    /* filtered lines never evaluate their arguments */
+    ll::log::set_level(ll::log_type_info);
+    ll_debug("not printed %u\n", count());
+    ll_info("printed %u\n", count());
+    cout << "evaluated " << evaluated << endl;
+
+    /* ll::debug itself skips the printer below the level */
+    ll::debug("not printed either\n");
+
+    /* net follows the global level until it is given its own */
+    ll_mdebug(net, "net debug hidden\n");
+    ll::log_module::set_level("net", ll::log_type_debug);
+    ll_mdebug(net, "net debug shown\n");
+    ll_mdebug(other_net, "net debug shown in the other instance\n");
+    ll_minfo(disk, "disk info hidden\n");
+    ll_merror(disk, "disk error shown\n");
+    cout << "unknown module rc " << ll::log_module::set_level("nope", ll::log_type_debug) << endl;
+
+    /* a disabled site is a load and a compare */
+    ll::time_trace t;
+    for (unsigned i = 0; i < 10000000; i++) {
+        ll_debug("%u\n", count());
+    }
+    cout << "10M disabled calls: " << t.check() << " us, evaluated " << evaluated << endl;
+
+    /* the header text is kept per thread and second, a line writes the ms digits */
+    char header[ll::log_header_size];
+    t.check();
+    for (unsigned i = 0; i < 1000000; i++) {
+        ll::log_header(ll::log_type_info, header, sizeof(header));
+    }
+    cout << "1M headers: " << t.check() << " us" << endl;
+
+    ll::log::set_time_format(ll::log_time_iso8601);
+    ll_info("iso-8601 utc\n");
+    ll::log::set_time_format(ll::log_time_iso8601 | ll::log_time_local);
+    ll_info("iso-8601 local\n");
+    ll::log::set_time_format(ll::log_time_local);
+    ll_info("local\n");
+
+    /* past year 9999 iso-8601 has no 4 digit form, the header keeps its shape */
+    long long y10k = 253402300800LL * ll::time::usecs_of_second;
+    for (int format = 0; format <= (ll::log_time_local | ll::log_time_iso8601); format++) {
+        ll::log::set_time_format(format);
+        size_t n = ll::log_header(ll::log_type_info, y10k - 1, header, sizeof(header));
+        size_t m = ll::log_header(ll::log_type_info, y10k, header, sizeof(header));
+        cout << std::string(header, m) << "| same width " << (n == m) << endl;
+    }
+    ll::log::set_time_format(ll::log_time_utc);
+
+    /* 3 lines a second get through, the rest are counted */
+    for (unsigned round = 0; round < 2; round++) {
+        for (unsigned i = 0; i < 100; i++) {
+            ll_error_ratelimit(3, "hot error %u\n", i);
+        }
+        usleep(1100000);
+    }
+    return 0;
+}
@@ -3,8 +3,11 @@
 using std::cout;
 using std::endl;
 
+#include <vector>
+
 #include "libll++/memory.h"
 #include "libll++/map.h"
+#include "libll++/timeval.h"
 
 struct foo {
     ll::map_entry _entry;
@@ -23,6 +26,17 @@ struct foo2 : foo {
     foo2(unsigned key, unsigned flag) : foo(key, flag) {}
 };
 
+/* keeps subtree sizes */
+struct bar {
+    ll::counted_map_entry _entry;
+    unsigned _key;
+    bar(unsigned key) : _key(key) {}
+
+    static unsigned get_key(bar *b) {
+        return b->_key;
+    }
+};
+
 int main()
 {
     ll_map(unsigned, foo2, _entry, ll::allocator) map;
@@ -72,6 +86,47 @@ int main()
     cout << map.front()->_key << endl;
     cout << map.back()->_key << endl;
 
+    cout << "====" << endl;
+    cout << map.lower_bound(3)->_key << " " << map.upper_bound(3)->_key << endl;
+    for (auto &obj : map.range(2, 7)) {
+        cout << obj._key << " ";
+    }
+    cout << endl;
+
+    cout << "====" << endl;
+    ll_map(unsigned, bar, _entry, ll::allocator) counted;
+    for (unsigned i = 0; i < 100; i++) {
+        counted.probe(i * 10, nullptr);
+    }
+    counted.remove((unsigned)500);
+    assert(counted.count() == 99);
+    assert(counted.rank(counted.get(510)) == 50);
+    assert(counted.select(50)->_key == 510);
+
+    /* percentiles */
+    cout << "p50=" << counted.select(counted.count() / 2)->_key
+         << " p99=" << counted.select(counted.count() * 99 / 100)->_key << endl;
+
+    cout << "====" << endl;
+    ll_map(unsigned, bar, _entry, ll::allocator) upper;
+    counted.split(700, upper);
+    cout << counted.count() << " " << upper.count() << " " << upper.front()->_key << endl;
+    counted.merge(upper);
+    cout << counted.count() << " " << upper.count() << endl;
+
+    /* a sorted snapshot, linked without a single compare */
+    static constexpr unsigned total = 1000000;
+    std::vector<bar*> snapshot;
+    for (unsigned i = 0; i < total; i++) {
+        snapshot.push_back(ll::_new<bar>(ll::pool::global(), i));
+    }
+    ll_map(unsigned, bar, _entry, ll::allocator) loaded;
+    ll::time_trace t;
+    loaded.build(snapshot.begin(), snapshot.end());
+    ll::timeval tv = t.check();
+    assert(loaded.count() == total && loaded.select(total / 2)->_key == total / 2);
+    cout << "build " << total << " usecs=" << tv << endl;
+
     return 0;
 }
 
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cassert>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/rcu_hashmap.h"
+#include "libll++/timeval.h"
+
+struct route {
+    unsigned _id;
+    unsigned _port;
+    route(unsigned id, unsigned port) : _id(id), _port(port) {}
+};
+
+static unsigned freed;
+
+static void count_free(void*)
+{
+    freed++;
+}
+
+/* a reader that goes offline or exits must not hold back reclamation */
+static void test_release()
+{
+    ll::epoch_domain domain;
+    std::atomic<int> step(0);
+    int obj;
+    bool ok = true;
+
+    /* online and never quiescent, the retire has to wait for it */
+    std::thread reader([&]() {
+        domain.online();
+        step = 1;
+        while (step != 2);
+        domain.offline();
+        step = 3;
+        while (step != 4);
+        domain.online();
+        step = 5;
+        while (step != 6);
+    });
+
+    while (step != 1);
+    domain.retire(&obj, count_free);
+    ok = ok && domain.reclaim() == 0 && domain.pending() == 1;
+
+    /* offline, the reader thread still lives */
+    step = 2;
+    while (step != 3);
+    ok = ok && domain.reclaim() == 1 && domain.pending() == 0;
+
+    /* online again and exits without going offline */
+    step = 4;
+    while (step != 5);
+    domain.retire(&obj, count_free);
+    ok = ok && domain.reclaim() == 0;
+    step = 6;
+    reader.join();
+    ok = ok && domain.reclaim() == 1 && domain.pending() == 0 && freed == 2;
+
+    cout << "release: freed=" << freed << " ok=" << ok << endl;
+}
+
+int main()
+{
+    test_release();
+
+    static constexpr unsigned keys = 5000;
+    ll::epoch_domain *domain = ll::epoch_domain::global();
+    ll::rcu_hashmap<unsigned, route> map(domain);
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned long> lookups(0);
+
+    /* readers announce a quiescent state after each pass, like a reactor loop */
+    std::vector<std::thread> readers;
+    for (unsigned i = 0; i < 4; i++) {
+        readers.emplace_back([&]() {
+            unsigned long n = 0;
+            domain->online();
+            while (!stop.load()) {
+                for (unsigned k = 0; k < keys; k++) {
+                    const route *r = map.get(k);
+                    if (r) {
+                        assert(r->_id == k && r->_port == k + 1000);
+                    }
+                    n++;
+                }
+                domain->quiescent();
+            }
+            domain->offline();
+            lookups += n;
+        });
+    }
+
+    ll::time_trace t;
+    for (unsigned round = 0; round < 50; round++) {
+        for (unsigned k = 0; k < keys; k++) {
+            map.set(k, k, k + 1000);
+        }
+        for (unsigned k = 0; k < keys; k += 2) {
+            map.remove(k);
+        }
+        domain->reclaim();
+    }
+    ll::timeval tv = t.check();
+
+    stop = true;
+    for (auto &th : readers) {
+        th.join();
+    }
+
+    cout << "count=" << map.count() << " lookups=" << lookups.load()
+         << " pending=" << domain->pending() << " time=" << tv << endl;
+    return 0;
+}
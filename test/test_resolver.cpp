@@ -0,0 +1,95 @@
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <cstring>
+#include <unistd.h>
+
+#include "libll++/resolver.h"
+#include "libll++/timeval.h"
+
+/* stub resolver, no network or system hosts file involved */
+static int stub_lookup(const char *host, const char *port, int family, ll::address *addrs, unsigned *count)
+{
+    struct {
+        const char *host;
+        const char *addr;
+    } hosts[] = {
+        { "one.test",  "10.0.0.1" },
+        { "two.test",  "10.0.0.2" },
+        { "six.test",  "fd00::6" },
+        { "slow.test", "10.0.0.9" },
+    };
+
+    if (!strcmp(host, "slow.test")) {
+        usleep(200 * 1000);
+    }
+
+    for (auto &h : hosts) {
+        if (strcmp(h.host, host)) {
+            continue;
+        }
+        return ll::resolver::default_lookup(h.addr, port, family, addrs, count);
+    }
+    return ll::e_notexists;
+}
+
+static unsigned pending = 0;
+
+static void print_result(const char *name, ll::resolver&, int rc, ll::address *addrs, unsigned count)
+{
+    pending--;
+    cout << name << ": rc=" << rc;
+    for (unsigned i = 0; i < count; i++) {
+        cout << " " << addrs[i].get_host() << ":" << addrs[i].get_port();
+    }
+    cout << endl;
+}
+
+int main()
+{
+    ll::reactor reactor;
+    ll::timer_manager timermgr;
+    ll::resolver resolver(&reactor, nullptr, stub_lookup);
+    ll_failed_return(resolver.start());
+
+    const char *names[] = { "slow.test", "one.test", "two.test", "six.test", "none.test", "one.test" };
+    for (auto name : names) {
+        pending++;
+        resolver.resolve(name, "80", AF_UNSPEC, print_result, name);
+    }
+
+    /* the reactor keeps ticking while slow.test is being looked up */
+    unsigned ticks = 0;
+    while (pending) {
+        timermgr.loop();
+        ll_failed_return(reactor.loop(ll::time_prec_msec::to_timeval(10)));
+        ticks++;
+    }
+    cout << "ticks=" << ticks << endl;
+
+    /* served from the positive and negative cache */
+    pending += 2;
+    resolver.resolve("one.test", "80", AF_UNSPEC, print_result, "one.test cached");
+    resolver.resolve("none.test", "80", AF_UNSPEC, print_result, "none.test cached");
+    cout << "pending=" << pending << endl;
+
+    /* flushed names go with the next lookup, after that the cap holds */
+    cout << "cached=" << resolver.cached_count() << endl;
+    resolver.flush_cache();
+    resolver.set_max_entries(2);
+    const char *more[] = { "two.test", "six.test", "one.test" };
+    for (auto name : more) {
+        pending++;
+        resolver.resolve(name, "80", AF_UNSPEC, print_result, name);
+        while (pending) {
+            timermgr.loop();
+            ll_failed_return(reactor.loop(ll::time_prec_msec::to_timeval(10)));
+        }
+        cout << "cached=" << resolver.cached_count() << endl;
+    }
+
+    resolver.stop();
+    return 0;
+}
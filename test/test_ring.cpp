@@ -0,0 +1,176 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cassert>
+
+using std::cout;
+using std::endl;
+
+#include "libll++/ring.h"
+#include "libll++/timeval.h"
+
+static constexpr unsigned long total = 1000000;
+
+struct item {
+    ll::slist_entry _entry;
+    unsigned long _value;
+};
+
+typedef ll::mpsc_stack<item, ll::slist_entry, &item::_entry> item_stack;
+
+/* producers and consumers may share threads, threads is how many ran */
+static void report(const char *name, unsigned producers, unsigned consumers, unsigned threads, ll::timeval tv)
+{
+    cout << name << " " << producers << "p/" << consumers << "c on " << threads << (threads > 1 ? " threads " : " thread ")
+         << (unsigned long)(total * 1000000.0 / (tv ? tv : 1)) << " ops/s" << endl;
+}
+
+static void bench_spsc()
+{
+    ll::spsc_ring<unsigned long> ring(1024);
+    unsigned long sum = 0;
+
+    ll::time_trace t;
+    std::thread consumer([&]() {
+        unsigned long v;
+        for (unsigned long n = 0; n < total;) {
+            if (ring.pop(v)) {
+                sum += v;
+                n++;
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (unsigned long i = 0; i < total; i++) {
+        while (!ring.push(i)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    ll::timeval tv = t.check();
+
+    assert(sum == total * (total - 1) / 2);
+    report("spsc_ring", 1, 1, 2, tv);
+}
+
+/* threads is the total, half produce and half consume, 1 pushes and pops in turn */
+static void bench_mpmc(unsigned threads)
+{
+    ll::mpmc_ring<unsigned long> ring(1024);
+    std::atomic<unsigned long> sum(0);
+    unsigned pairs = threads / 2;
+
+    ll::time_trace t;
+    if (!pairs) {
+        unsigned long v = 0, s = 0;
+        for (unsigned long i = 0; i < total; i++) {
+            bool pushed = ring.push(i);
+            bool popped = ring.pop(v);
+            assert(pushed && popped && v == i);
+            (void)pushed;
+            (void)popped;
+            s += v;
+        }
+        sum = s;
+    }
+    else {
+        std::vector<std::thread> workers;
+        for (unsigned p = 0; p < pairs; p++) {
+            workers.emplace_back([&, p]() {
+                for (unsigned long i = p; i < total; i += pairs) {
+                    while (!ring.push(i)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            workers.emplace_back([&, p]() {
+                unsigned long v, s = 0;
+                unsigned long count = (total - p + pairs - 1) / pairs;
+                for (unsigned long n = 0; n < count;) {
+                    if (ring.pop(v)) {
+                        s += v;
+                        n++;
+                    }
+                    else {
+                        std::this_thread::yield();
+                    }
+                }
+                sum += s;
+            });
+        }
+        for (auto &th : workers) {
+            th.join();
+        }
+    }
+    ll::timeval tv = t.check();
+
+    assert(sum == total * (total - 1) / 2);
+    report("mpmc_ring", pairs ? pairs : 1, pairs ? pairs : 1, pairs ? pairs * 2 : 1, tv);
+}
+
+/* threads - 1 producers, one consumer taking everything at once */
+static void bench_mpsc(unsigned threads)
+{
+    item_stack stack;
+    std::vector<item> items(total);
+    unsigned producers = threads > 1 ? threads - 1 : 1;
+    std::atomic<unsigned> done(0);
+    unsigned long sum = 0;
+
+    ll::time_trace t;
+    std::vector<std::thread> workers;
+    for (unsigned p = 0; p < producers; p++) {
+        workers.emplace_back([&, p]() {
+            for (unsigned long i = p; i < total; i += producers) {
+                items[i]._value = i;
+                stack.push(&items[i]);
+            }
+            done++;
+        });
+    }
+    for (unsigned long n = 0; n < total;) {
+        item_stack::list_t l = stack.take_all();
+        if (l.empty()) {
+            std::this_thread::yield();
+            continue;
+        }
+        while (item *i = l.pop_front()) {
+            sum += i->_value;
+            n++;
+        }
+    }
+    for (auto &th : workers) {
+        th.join();
+    }
+    ll::timeval tv = t.check();
+
+    assert(done == producers && stack.empty());
+    assert(sum == total * (total - 1) / 2);
+    report("mpsc_stack", producers, 1, producers + 1, tv);
+}
+
+int main()
+{
+    bench_spsc();
+    for (unsigned threads = 1; threads <= 64; threads <<= 1) {
+        bench_mpmc(threads);
+    }
+    for (unsigned threads = 2; threads <= 64; threads <<= 1) {
+        bench_mpsc(threads);
+    }
+
+    /* the stack keeps the push order for take_all, pop gives the newest */
+    item a, b, c;
+    item_stack stack;
+    bool first = stack.push(&a);
+    stack.push(&b);
+    stack.push(&c);
+    item *top = stack.pop();
+    item_stack::list_t l = stack.take_all();
+    cout << "first " << first << " pop " << (top == &c)
+         << " order " << (l.pop_front() == &a) << (l.pop_front() == &b) << l.empty() << endl;
+    return 0;
+}
@@ -5,7 +5,11 @@
 using std::cout;
 using std::endl;
 
+#include <unistd.h>
+#include <sys/socket.h>
+
 #include "libll++/slotsig.h"
+#include "libll++/reactor.h"
 #include "libll++/memory.h"
 #include "libll++/timeval.h"
 
@@ -93,6 +97,121 @@ int main()
     once_sig.connect(&foo::dodo, f, 100);
     once_sig.emit();
 #endif
+
+    /* slots disconnect themselves and connect others from inside emit */
+    do {
+        typedef ll::signal<void(int)> sig_t;
+        static sig_t sig;
+        static sig_t::slot *once;
+        once = sig.connect([](int n) {
+            cout << "once " << n << endl;
+            sig.disconnect(once);
+        });
+        sig.connect([](int n) {
+            cout << "every " << n << endl;
+            if (n == 0) {
+                sig.connect([](int n) { cout << "late " << n << endl; });
+                sig.emit(1);
+            }
+        });
+        sig.emit(0);
+        sig.emit(2);
+        sig.disconnect_all();
+    } while (0);
+
+    /* type erased against statically bound emission */
+    do {
+        ll::signal<int(int), true> sig;
+        sig.connect([&m](int n) { m += n; return 0; });
+        ll::time_trace t;
+        for (unsigned n = 0; n < COUNT; n++) {
+            sig.emit(n);
+        }
+        cout << "signal emit: " << ll::time_prec_msec::to_precval(t.check()) << endl;
+    } while (0);
+
+    do {
+        auto d = ll::make_delegate<int(int)>([&m](int n) { m += n; return 0; });
+        ll::time_trace t;
+        for (unsigned n = 0; n < COUNT; n++) {
+            d.emit(n);
+        }
+        cout << "delegate emit: " << ll::time_prec_msec::to_precval(t.check()) << endl;
+    } while (0);
+    cout << m << endl;
+
+    /* events per second through the reactor, each round wakes every pair */
+    do {
+        static constexpr unsigned pairs = 64;
+        static constexpr unsigned rounds = 20000;
+        ll::reactor r(pairs * 2 + 16, pairs);
+        int fds[pairs][2];
+        unsigned events = 0;
+        char c = 0;
+
+        auto reader = [&events](ll::reactor::io &io, int flags) {
+            char buf[16];
+            while (::read(io, buf, sizeof(buf)) > 0);
+            events++;
+            return 0;
+        };
+
+        for (unsigned i = 0; i < pairs; i++) {
+            socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]);
+            r.open(fds[i][1], ll::reactor::poll_in, reader);
+        }
+
+        ll::time_trace t;
+        for (unsigned n = 0; n < rounds; n++) {
+            for (unsigned i = 0; i < pairs; i++) {
+                ::write(fds[i][0], &c, 1);
+            }
+            r.loop(ll::time_prec_msec::to_timeval(1));
+        }
+        cout << "signal loop: " << (uint64_t)events * 1000 / (ll::time_prec_msec::to_precval(t.check()) + 1) 
+             << " events/s" << endl;
+
+        events = 0;
+        t.reset();
+        for (unsigned n = 0; n < rounds; n++) {
+            for (unsigned i = 0; i < pairs; i++) {
+                ::write(fds[i][0], &c, 1);
+            }
+            r.loop(ll::time_prec_msec::to_timeval(1), reader);
+        }
+        cout << "delegate loop: " << (uint64_t)events * 1000 / (ll::time_prec_msec::to_precval(t.check()) + 1) 
+             << " events/s" << endl;
+
+        for (unsigned i = 0; i < pairs; i++) {
+            r.close(fds[i][1]);
+            ::close(fds[i][0]);
+            ::close(fds[i][1]);
+        }
+    } while (0);
+
+    /* a failed handler closes the fd, the close goes to the handler, not the signal */
+    do {
+        ll::reactor r;
+        int fds[2];
+        unsigned closes = 0, signals = 0;
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        r.open(fds[1], ll::reactor::poll_in, [&signals](ll::reactor::io&, int) {
+            signals++;
+            return 0;
+        });
+
+        ::write(fds[0], "x", 1);
+        r.loop(ll::time_prec_msec::to_timeval(10), [&closes](ll::reactor::io &io, int flags) {
+            if (flags & ll::reactor::poll_close) {
+                closes++;
+                return io.close();
+            }
+            return (int)ll::fail;
+        });
+        cout << "failed handler: closes=" << closes << " signals=" << signals
+             << " watched=" << r.get(fds[1])->opened() << endl;
+        ::close(fds[0]);
+    } while (0);
     return 0;
 }
 
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <thread>
+#include <string>
+
+using std::cout;
+using std::endl;
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "libll++/socket.h"
+#include "libll++/timeval.h"
+
+static constexpr size_t chunk_size = 64 * 1024;
+static constexpr size_t total_size = 1024 * 1024 * 1024;
+
+struct bench {
+    ll::reactor reactor;
+    ll::timer_manager timermgr;
+    ll::addrinfo addr;
+    ll::listener listener;
+    int fd;
+
+    bench() : reactor(), timermgr(), fd(-1) {}
+
+    int accept_handler(ll::listener&, int fd, int type, ll::address &peer) {
+        if (type & ll::reactor::poll_in) {
+            cout << "accept " << fd << " from " << peer.get_host() << endl;
+            this->fd = fd;
+        }
+        return 0;
+    }
+
+    static void writer(ll::address addr) {
+        int fd = ::socket(addr.family(), SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, addr, addr.length()) < 0) {
+            cout << "connect failed" << endl;
+            return;
+        }
+        static char buf[chunk_size];
+        for (size_t n = 0; n < total_size; n += chunk_size) {
+            if (::write(fd, buf, chunk_size) != (ssize_t)chunk_size) {
+                break;
+            }
+        }
+        ::close(fd);
+    }
+
+    int run(const char *uri) {
+        ll_failed_return(addr.init(uri, ll::pool::global()));
+        ll_failed_return(addr.resolve());
+        listener.set_addr(addr);
+        listener.set_reactor(&reactor);
+        listener.set_timer_manager(&timermgr);
+        ll_failed_return(listener.listen(&bench::accept_handler, this));
+
+        std::thread t(writer, addr);
+        while (fd < 0) {
+            ll_failed_return(reactor.loop(ll::time_prec_msec::to_timeval(10)));
+        }
+
+        ll::timeval start = ll::time::now();
+        static char buf[chunk_size];
+        size_t received = 0;
+        ssize_t n;
+        while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+            received += n;
+        }
+        ll::timeval elapsed = ll::time::now() - start;
+        t.join();
+        ::close(fd);
+        listener.close();
+
+        double sec = (double)elapsed / ll::time::usecs_of_second;
+        cout << uri << ": " << received / (1024 * 1024) << "MB in " << sec << "s, "
+             << (sec > 0 ? received / sec / (1024 * 1024) : 0) << "MB/s" << endl;
+        return ll::ok;
+    }
+};
+
+static void test_names()
+{
+    constexpr size_t max = sizeof(((sockaddr_un*)nullptr)->sun_path);
+    constexpr size_t base = offsetof(sockaddr_un, sun_path);
+    std::string path(max, 'p');
+    path[0] = '/';
+    std::string name(max, 'a');
+    name[0] = '@';
+
+    ll::address a;
+    cout << "path of " << max << ": " << a.set_unix(path.c_str()) << endl;
+    path.pop_back();
+    cout << "path of " << max - 1 << ": " << a.set_unix(path.c_str())
+         << ", len " << a.length() - base << ", abstract " << a.is_abstract() << endl;
+    cout << "abstract of " << max << ": " << a.set_unix(name.c_str())
+         << ", len " << a.length() - base << ", abstract " << a.is_abstract() << endl;
+    name.push_back('a');
+    cout << "abstract of " << max + 1 << ": " << a.set_unix(name.c_str()) << endl;
+}
+
+int main()
+{
+    test_names();
+    {
+        bench b;
+        ll_failed_return(b.run("127.0.0.1:23456"));
+    }
+    {
+        bench b;
+        ll_failed_return(b.run("unix:/tmp/test_uds.sock"));
+    }
+    {
+        bench b;
+        ll_failed_return(b.run("unix:@test_uds"));
+    }
+    return 0;
+}
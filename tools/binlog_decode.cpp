@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+#include "libll++/binlog.h"
+
+/* ll_binlog [-l] [-i] [file]: prints a binlog stream as the text log would
+ * have, lines from all threads ordered by time. -l shows local time, -i
+ * iso-8601. reads stdin without a file. */
+
+static bool read_all(FILE *fp, std::string &data)
+{
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.append(buf, n);
+    }
+    return !ferror(fp);
+}
+
+int main(int argc, char **argv)
+{
+    int time_format = ll::log_time_utc;
+    int opt;
+    while ((opt = getopt(argc, argv, "li")) != -1) {
+        switch (opt) {
+        case 'l':
+            time_format |= ll::log_time_local;
+            break;
+        case 'i':
+            time_format |= ll::log_time_iso8601;
+            break;
+        default:
+            fprintf(stderr, "usage: ll_binlog [-l] [-i] [file]\n");
+            return 1;
+        }
+    }
+    ll::log::set_time_format(time_format);
+
+    const char *path = optind < argc ? argv[optind] : nullptr;
+    FILE *fp = path ? fopen(path, "rb") : stdin;
+    if (!fp) {
+        fprintf(stderr, "ll_binlog: cannot open %s\n", path);
+        return 1;
+    }
+    std::string data;
+    if (!read_all(fp, data)) {
+        fprintf(stderr, "ll_binlog: read error\n");
+        return 1;
+    }
+    if (fp != stdin) {
+        fclose(fp);
+    }
+
+    std::string out, errors;
+    if (ll_failed(ll::binlog_decode(data.data(), data.size(), out, &errors))) {
+        fprintf(stderr, "ll_binlog: not a binlog stream\n");
+        return 1;
+    }
+    fwrite(out.data(), 1, out.size(), stdout);
+
+    /* one problem per line */
+    size_t pos = 0, end;
+    while ((end = errors.find('\n', pos)) != std::string::npos) {
+        fprintf(stderr, "ll_binlog: %.*s\n", (int)(end - pos), errors.data() + pos);
+        pos = end + 1;
+    }
+    return 0;
+}